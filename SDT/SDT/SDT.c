@@ -1,30 +1,180 @@
 #include <stdio.h>
-#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <setjmp.h>
+
+/*
+ * size of the blocks stdin is read in and stdout is written in
+ */
+#define BUFFER_SIZE (1 << 20)
+
+/*
+ * deepest nesting of parentheses accepted; each level takes a few
+ * stack frames
+ */
+#define MAX_NESTING 1024
 
 int currentToken;
 
-/* 
+/*
+ * the unread part of the input block
+ */
+char inputBuffer[BUFFER_SIZE];
+char* inputNext = inputBuffer;
+char* inputEnd = inputBuffer;
+/* read a line at a time instead of a whole block */
+int isInteractive = 1;
+
+/*
+ * the output not written yet
+ */
+char outputBuffer[BUFFER_SIZE];
+size_t outputLength = 0;
+
+/*
+ * where `error` returns to in the streaming mode, NULL to exit
+ */
+jmp_buf* recovery = NULL;
+const char* errorMessage;
+/* the error is about a value, not about a missing or unexpected token */
+int isLimitError = 0;
+int nesting = 0;
+
+/*
  * function prototypes
  */
 void error(char* msg);
-int exp();
-int factor();
+void limitError(char* msg);
+long long exp();
+long long factor();
 void match(int tokenMatched, int expectedToken);
-int expPrime(int inherited);
+long long expPrime(long long inherited);
+
+/*
+ * description:
+ * Read the next block of the input.
+ *
+ * return:
+ * The first character of the block, or EOF.
+ */
+int fillInput()
+{
+	size_t length;
+	if (isInteractive) length = fgets(inputBuffer, BUFFER_SIZE, stdin) ? strlen(inputBuffer) : 0;
+	else length = fread(inputBuffer, 1, BUFFER_SIZE, stdin);
+	if (!length) return EOF;
+	inputNext = inputBuffer + 1;
+	inputEnd = inputBuffer + length;
+	return (unsigned char)inputBuffer[0];
+}
 
 /*
- * description: 
+ * description:
+ * Get the next character of the input.
+ *
+ * return:
+ * The character, or EOF.
+ */
+int nextChar()
+{
+	return inputNext < inputEnd ? (unsigned char)*inputNext++ : fillInput();
+}
+
+/*
+ * description:
+ * Move to the next token, skipping blanks.
+ */
+void advance()
+{
+	do currentToken = nextChar();
+	while (currentToken == ' ' || currentToken == '\t' || currentToken == '\r');
+}
+
+/*
+ * description:
+ * Write out the buffered output.
+ */
+void flushOutput()
+{
+	if (outputLength && fwrite(outputBuffer, 1, outputLength, stdout) != outputLength)
+	{
+		fprintf(stderr, "Cannot write the output.\n");
+		exit(1);
+	}
+	outputLength = 0;
+}
+
+/*
+ * description:
+ * Write a line to the buffered output.
+ *
+ * parameter(s):
+ * const char* text: The line without its '\n'.
+ */
+void writeLine(const char* text)
+{
+	size_t length = strlen(text);
+	if (outputLength + length + 1 > BUFFER_SIZE) flushOutput();
+	memcpy(outputBuffer + outputLength, text, length);
+	outputLength += length;
+	outputBuffer[outputLength++] = '\n';
+}
+
+/*
+ * description:
+ * Write a result to the buffered output on a line of its own.
+ *
+ * parameter(s):
+ * long long value: The result, which is never negative.
+ */
+void writeResult(long long value)
+{
+	char digits[24];
+	int length = 0;
+	if (outputLength + sizeof(digits) > BUFFER_SIZE) flushOutput();
+	do
+	{
+		digits[length++] = (char)('0' + value % 10);
+		value /= 10;
+	} while (value);
+	while (length) outputBuffer[outputLength++] = digits[--length];
+	outputBuffer[outputLength++] = '\n';
+}
+
+/*
+ * description:
  * Execute errors.
- * 
+ *
  * parameter(s):
  * char* msg: The error message to be printed to the stderr.
  */
 void error(char* msg)
 {
+	if (recovery)
+	{
+		// the streaming mode reports the error and goes on with the next line
+		errorMessage = msg;
+		longjmp(*recovery, 1);
+	}
 	fprintf(stderr, "%s The current token is %c\n", msg, (char)currentToken);
 	exit(1);
 }
 
+/*
+ * description:
+ * Execute errors of numbers, sums or nesting beyond what the
+ * evaluator can hold, which the tokens read so far do not cause.
+ *
+ * parameter(s):
+ * char* msg: The error message to be printed to the stderr.
+ */
+void limitError(char* msg)
+{
+	isLimitError = 1;
+	error(msg);
+}
+
 /*
  * description:
  * Match the token.
@@ -35,7 +185,7 @@ void error(char* msg)
  */
 void match(int tokenMatched, int expectedToken)
 {
-	if (tokenMatched == expectedToken) currentToken = getchar();
+	if (tokenMatched == expectedToken) advance();
 	else error("Token mismatched.");
 }
 
@@ -43,27 +193,35 @@ void match(int tokenMatched, int expectedToken)
  * description:
  * Get the result of a factor.
  */
-int factor()
+long long factor()
 {
 	// basic lexical check
-	if (!isdigit(currentToken) && currentToken != '(') error("A valid factor should starts with either a decimal number or a '('.");
+	if (!(currentToken >= '0' && currentToken <= '9') && currentToken != '(') error("A valid factor should starts with either a decimal number or a '('.");
 
-	int temp;
-	if (isdigit(currentToken))
+	long long temp;
+	if (currentToken >= '0' && currentToken <= '9')
 	{
 		// get the number
-		ungetc(currentToken, stdin);
-		scanf("%d", &temp);
-		currentToken = getchar();
+		temp = 0;
+		do
+		{
+			int digit = currentToken - '0';
+			if (temp > (LLONG_MAX - digit) / 10) limitError("The number is too large.");
+			temp = temp * 10 + digit;
+			currentToken = nextChar();
+		} while (currentToken >= '0' && currentToken <= '9');
+		if (currentToken == ' ' || currentToken == '\t' || currentToken == '\r') advance();
 
 		return temp;
 	}
 	else
 	{
 		// get the value of an expression
+		if (++nesting > MAX_NESTING) limitError("The parentheses are nested too deeply.");
 		match(currentToken, '(');
 		temp = exp();
 		match(currentToken, ')');
+		nesting--;
 
 		return temp;
 	}
@@ -71,36 +229,39 @@ int factor()
 
 /*
  * description:
- * Get the result of the whole expression recursively.
- * 
+ * Get the result of the whole expression.
+ * exp'_1 -> + factor exp'_2 ends with its only recursive call, so the
+ * chain of exp' is walked in a loop which keeps the inherited
+ * attribute, instead of a stack frame per term.
+ *
  * parameter(s);
- * int inherited: current partial summation
+ * long long inherited: current partial summation
  */
-int expPrime(int inherited)
+long long expPrime(long long inherited)
 {
-	switch (currentToken)
+	while (currentToken == '+')
 	{
-	case '+':
 		match(currentToken, '+');
 		// call factor()
 		// and execute the semantic rule: exp'_2.inh = exp'_1.inh + factor.syn
-		// at last execute the semantic rule: exp'_1.syn = exp'_2.syn
-		return expPrime(inherited + factor());
-	default:
-		// encounter the EOF
-		// execute the semantic rule: exp'.syn = exp'.inh
-		return inherited;
+		long long synthesized = factor();
+		if (inherited > LLONG_MAX - synthesized) limitError("The sum is too large.");
+		inherited += synthesized;
 	}
+	// encounter the end of the expression
+	// execute the semantic rule: exp'.syn = exp'.inh
+	// which every exp'_1 passes on by exp'_1.syn = exp'_2.syn
+	return inherited;
 }
 
 /*
  * description:
  * Get the result of the whole expression.
  */
-int exp()
+long long exp()
 {
 	// basic lexical check
-	if (!isdigit(currentToken) && currentToken != '(') error("A valid expression should starts with either a decimal number or a '('.");
+	if (!(currentToken >= '0' && currentToken <= '9') && currentToken != '(') error("A valid expression should starts with either a decimal number or a '('.");
 
 	// call factor()
 	// and execute the semantic rule: exp'.inh = factor.syn
@@ -108,15 +269,74 @@ int exp()
 	return expPrime(factor());
 }
 
-int main()
+/*
+ * description:
+ * Evaluate the expressions of stdin, one per line, and write their
+ * results to stdout, one per line. A line with an error gets
+ * "error" and the error goes to stderr. A blank line stays blank.
+ *
+ * return:
+ * 0 if every line is valid, 1 otherwise.
+ */
+int stream()
 {
+	jmp_buf here;
+	// both are changed between setjmp and longjmp
+	volatile long long line = 0, errors = 0;
+	isInteractive = 0;
+	recovery = &here;
+
+	advance();
+	// an error in a line comes back here
+	if (setjmp(here))
+	{
+		if (errors++ < 20)
+		{
+			if (currentToken != EOF && currentToken != '\n') fprintf(stderr, "line %lld: %s The current token is %c\n", line, errorMessage, (char)currentToken);
+			// only a syntax error at the end of a line is a missing token
+			else if (!isLimitError) fprintf(stderr, "line %lld: %s The line ends too early.\n", line, errorMessage);
+			else fprintf(stderr, "line %lld: %s\n", line, errorMessage);
+		}
+		isLimitError = 0;
+		writeLine("error");
+		// skip the rest of the line
+		while (currentToken != '\n' && currentToken != EOF) currentToken = nextChar();
+		if (currentToken == '\n') advance();
+	}
+	while (currentToken != EOF)
+	{
+		line++;
+		if (currentToken == '\n') writeLine("");
+		else
+		{
+			nesting = 0;
+			long long result = exp();
+			if (currentToken != '\n' && currentToken != EOF) error("Unexpected token after the expression.");
+			writeResult(result);
+		}
+		if (currentToken == '\n') advance();
+	}
+	flushOutput();
+	if (errors) fprintf(stderr, "%lld of %lld lines have errors\n", errors, line);
+	return errors ? 1 : 0;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc == 2 && !strcmp(argv[1], "-stream")) return stream();
+	if (argc != 1)
+	{
+		fprintf(stderr, "usage: %s [-stream]\n", argv[0]);
+		return 1;
+	}
+
 	printf("Input a simple arithmic expression:\n");
 
 	// look ahead for one char
-	currentToken = getchar();
-	int result = exp();
+	advance();
+	long long result = exp();
+
+	printf("=%lld\n", result);
 
-	printf("=%d\n", result);
-	
 	return 0;
-}
\ No newline at end of file
+}
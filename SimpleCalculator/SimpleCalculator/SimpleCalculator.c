@@ -1,8 +1,26 @@
+#ifndef _WIN32
+// madvise is not POSIX, so strict C modes would hide it
+#define _DEFAULT_SOURCE
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
 #include <time.h>
 #include <string.h>
+#include <limits.h>
+#include <threads.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 #define TRUE 1
 #define FALSE 0
 #define ON 1
@@ -12,33 +30,172 @@
 #define RIGHT -1
 #define LEFT -2
 #define RELEASE_FLAG OFF
+// number of expressions generated, solved and written at a time
+#define CHUNK_SIZE 4096
+// size of the buffer of a `Writer`
+#define WRITER_BUFFER_SIZE (1 << 20)
+// number of worker threads unless given on the command line
+#define NUMBER_OF_THREADS 8
+// number of chunks per worker that may be queued or solved ahead of
+// the one being written
+#define JOBS_PER_THREAD 2
+// size of a buffer which holds an expression of at most NUMBER_OF_OPERATOR operators
+#define EXPRESSION_BUFFER_SIZE (NUMBER_OF_OPERATOR + 3 * (NUMBER_OF_OPERATOR + 1) + 100)
+// the right associative form adds a pair of parenthesis per operator
+#define REWRITTEN_BUFFER_SIZE (3 * EXPRESSION_BUFFER_SIZE)
+// set BENCHMARK_FLAG to ON to check the evaluator and measure its speed instead
+#define BENCHMARK_FLAG OFF
+// set BATCH_FLAG to OFF to solve every expression with `getResult`
+#define BATCH_FLAG ON
+#define NUMBER_OF_OPERANDS (NUMBER_OF_OPERATOR + 1)
+// a postfix program has an instruction per operand and per operator
+#define PROGRAM_SIZE (NUMBER_OF_OPERANDS + NUMBER_OF_OPERATOR)
+// number of expression shapes a batch can tell apart
+#define MAX_SHAPES 1024
+#define SHAPE_TABLE_SIZE (2 * MAX_SHAPES)
+// number of expressions evaluated together, one per 64-bit AVX2 lane;
+// AVX2 is only used when the compiler targets it (-mavx2, /arch:AVX2),
+// which the projects do not, so that the program runs on any x64 CPU
+#define LANES 4
+// deepest nesting of operators and parenthesis the verifier accepts
+#define VERIFIER_STACK_SIZE 256
+// number of failed lines the verifier prints
+#define MAX_REPORTED_FAILURES 20
+// results of checking a line of `output.txt`
+#define CHECK_OK 0
+#define CHECK_WRONG 1
+#define CHECK_OVERFLOW 2
+#define CHECK_DIVIDED_BY_ZERO 3
+#define CHECK_MALFORMED 4
+// the heading of the right associative answers when RELEASE_FLAG is ON
+#define RIGHT_HEADING "Answers in the right associative order:"
 
+// the right associative form of an expression, written while it is parsed
 typedef struct
 {
-	char* rewrittenExpressions[NUMBER_OF_QUESTION];
-	size_t currentRewrittenExpressionIndex;
-	size_t currentRewrittenExpressionNextCharIndex;
-} RewrittenExpressions;
+	char* text;
+	size_t length;
+} RewrittenExpression;
 
 typedef long long LL;
 
-LL exp(char* expression, size_t* nextIndex, char* globalToken, int* isDividedByZero, int associativity, RewrittenExpressions* rewrittenExpressions);
-LL factor(char* expression, size_t* nextIndex, char* globalToken, int* isDividedByZero, int associativity, RewrittenExpressions* rewrittenExpressions);
-LL term(char* expression, size_t* nextIndex, char* globalToken, int* isDividedByZero, int associativity, RewrittenExpressions* rewrittenExpressions);
-LL getInt(char* expression, size_t* nextIndex, char* globalToken, int associativity, RewrittenExpressions* rewrittenExpressions);
+// the state of a xoshiro256** generator
+typedef struct
+{
+	unsigned long long state[4];
+} Random;
 
-/*********************************************************************************
- * description: 
- * unget the current token. Actually just decrease the `nextIndex`
- *
- * arguments:
- * size_t* nextIndex: the position where the next character lies
- *********************************************************************************/
-void ungetNextChar(size_t* nextIndex)
+typedef struct
 {
-	if (*nextIndex > 0) --(*nextIndex);
-	return;
-}
+	FILE* file;
+	size_t length;
+	char buffer[WRITER_BUFFER_SIZE];
+} Writer;
+
+// the structure of expressions which differ only in their numbers,
+// e.g. "(#+#)/#*#", compiled once into postfix programs whose
+// instructions are operand numbers or operators
+typedef struct
+{
+	char shape[EXPRESSION_BUFFER_SIZE];
+	unsigned hash;
+	char leftProgram[PROGRAM_SIZE];
+	char rightProgram[PROGRAM_SIZE];
+	// the right associative form, '#' standing for the numbers
+	char rewrittenShape[REWRITTEN_BUFFER_SIZE];
+	// the expressions of the current chunk with this shape are
+	// `order[start]` to `order[start + count - 1]`
+	int start;
+	int count;
+} Shape;
+
+// expressions of a chunk grouped by shape, whose numbers are laid out
+// column by column so that an instruction runs over a whole group
+typedef struct
+{
+	Shape shapes[MAX_SHAPES];
+	int numberOfShapes;
+	// shape number + 1 for each slot, 0 when free
+	int shapeTable[SHAPE_TABLE_SIZE];
+	// the shape of each expression, or -1 if it must go to `getResult`
+	int shapeOf[CHUNK_SIZE];
+	// the expressions sorted by shape
+	int order[CHUNK_SIZE];
+	LL operands[CHUNK_SIZE][NUMBER_OF_OPERANDS];
+	// operand j of `order[k]` is `columns[j][k]`; the LANES extra
+	// values let the last group of a column be loaded whole
+	LL columns[NUMBER_OF_OPERANDS][CHUNK_SIZE + LANES];
+	// the stack of a running program, one column per entry
+	LL stack[NUMBER_OF_OPERANDS][CHUNK_SIZE + LANES];
+	char dividedByZero[CHUNK_SIZE + LANES];
+	LL leftResults[CHUNK_SIZE];
+	LL rightResults[CHUNK_SIZE];
+	char leftDividedByZero[CHUNK_SIZE];
+	char rightDividedByZero[CHUNK_SIZE];
+} Batch;
+
+// a chunk of questions handed to a worker thread
+typedef struct
+{
+	unsigned long long seed;
+	size_t chunk;
+	size_t count;
+	Random random;
+	char expressions[CHUNK_SIZE][EXPRESSION_BUFFER_SIZE];
+#if BATCH_FLAG == ON
+	Batch batch;
+#endif
+	Writer leftAnswers;
+	Writer rightAnswers;
+	// set by the worker once the answers are ready to be written
+	int solved;
+} Job;
+
+// the chunks shared by the main thread and the workers: chunk `c` is
+// solved in `jobs[c % numberOfJobs]`, the chunks below `queued` have
+// been handed out by the main thread and those below `taken` have been
+// picked up by a worker
+typedef struct
+{
+	Job* jobs;
+	size_t numberOfJobs;
+	size_t queued;
+	size_t taken;
+	int finished;
+	mtx_t lock;
+	// signalled when a chunk is queued or no more will be
+	cnd_t work;
+	// signalled when a worker has solved a chunk
+	cnd_t solved;
+} Queue;
+
+// a line of `output.txt` which failed the check
+typedef struct
+{
+	size_t line;
+	const char* text;
+	size_t length;
+	int status;
+	LL value;
+} Failure;
+
+// a part of `output.txt` checked by a verifier thread
+typedef struct
+{
+	const char* begin;
+	const char* end;
+	// the lines from here on are in the right associative order
+	const char* right;
+	size_t lines;
+	size_t checked;
+	size_t failed;
+	Failure failures[MAX_REPORTED_FAILURES];
+} Part;
+
+LL exp(char* expression, size_t* nextIndex, char* globalToken, int* isDividedByZero, int associativity, RewrittenExpression* rewrittenExpression);
+LL factor(char* expression, size_t* nextIndex, char* globalToken, int* isDividedByZero, int associativity, RewrittenExpression* rewrittenExpression);
+LL term(char* expression, size_t* nextIndex, char* globalToken, int* isDividedByZero, int associativity, RewrittenExpression* rewrittenExpression);
+LL getInt(char* expression, size_t* nextIndex, char* globalToken, RewrittenExpression* rewrittenExpression);
 
 /*********************************************************************************
  * description: 
@@ -60,35 +217,86 @@ char getNextChar(char* expression, size_t* nextIndex)
 	else return expression[*nextIndex];
 }
 
+/*********************************************************************************
+ * description: 
+ * seed a generator with the `stream`-th sequence of `seed`. The state is filled
+ * by splitmix64, so that nearby seeds and streams give unrelated sequences
+ *
+ * arguments:
+ * Random* random: the generator to be seeded
+ * unsigned long long seed: the seed of the run
+ * unsigned long long stream: the number of the sequence, e.g. a chunk index
+ *********************************************************************************/
+void seedRandom(Random* random, unsigned long long seed, unsigned long long stream)
+{
+	unsigned long long x = seed ^ (stream * 0xD1B54A32D192ED03ULL);
+	for (int i = 0; i < 4; i++)
+	{
+		unsigned long long z = (x += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		random->state[i] = z ^ (z >> 31);
+	}
+}
+
+/*********************************************************************************
+ * description: 
+ * get the next 64 random bits from a xoshiro256** generator
+ *
+ * arguments:
+ * Random* random: the generator
+ *
+ * return:
+ * 64 random bits
+ *********************************************************************************/
+unsigned long long nextRandom(Random* random)
+{
+	unsigned long long* s = random->state;
+	unsigned long long result = s[1] * 5;
+	result = ((result << 7) | (result >> 57)) * 9;
+	unsigned long long t = s[1] << 17;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = (s[3] << 45) | (s[3] >> 19);
+	return result;
+}
+
 /*********************************************************************************
  * description: 
  * get a random number from [lower, upper]
  * 
  * arguments:
+ * Random* random: the generator to draw from
  * int lower: the lower boundery of the range where the number will be generated
  * int upper: the upper boundery of the range where the number will be generated
  * 
  * return:
  * a random number in the range [lower, upper]
  *********************************************************************************/
-int getRandomNumber(int lower, int upper)
+int getRandomNumber(Random* random, int lower, int upper)
 {
 	if (lower <= upper)
-		return rand() % (upper - lower + 1) + lower;
+		return (int)(nextRandom(random) % (upper - lower + 1)) + lower;
 	else
-		return rand() % (lower - upper + 1) + upper;
+		return (int)(nextRandom(random) % (lower - upper + 1)) + upper;
 }
 
 /*******************************************************************
  * description: 
  * get a random operator from {'+', '-', '*', '/'}
  *
+ * argument:
+ * Random* random: the generator to draw from
+ *
  * return:
  * a random operator
  *******************************************************************/
-char getRandomOperator()
+char getRandomOperator(Random* random)
 {
-	int temp = rand((unsigned int)time(NULL)) % 4;
+	int temp = (int)(nextRandom(random) % 4);
 	switch (temp)
 	{
 	case 0:
@@ -97,7 +305,7 @@ char getRandomOperator()
 		return '-';
 	case 2:
 		return '*';
-	case 3:
+	default:
 		return '/';
 	}
 }
@@ -153,7 +361,8 @@ int char2Digit(char character)
  *****************************************************************************/
 void putNumber(int number, char* expression, size_t* currentIndex)
 {
-	char buffer[10000] = { '\0' };
+	// an int has at most 10 digits
+	char buffer[10];
 	int length = 0;
 	// put the number into the `buffer`
 	do
@@ -210,7 +419,8 @@ int isSpecialCase(char* expression)
 
 	// test whether the `expression` contains "(number)"
 	int leftFound = FALSE;
-	for (int i = 0; i < strlen(expression); i++)
+	size_t length = strlen(expression);
+	for (size_t i = 0; i < length; i++)
 	{
 		if (expression[i] == '(') leftFound = TRUE;
 		else if (expression[i] == ')' && leftFound) return TRUE;
@@ -247,22 +457,18 @@ void insert(char* expression, char character, int index)
  * description: 
  * add a pair of parenthesis to the expression randomly
  * 
- * argument:
+ * arguments:
  * char* expression: the string which holds the expression
+ * Random* random: the generator to draw from
  * 
  * return:
  * the string which holds the expression
  ********************************************************************/
-char* addParenthesis(char* expression)
+char* addParenthesis(char* expression, Random* random)
 {
 	// initialize the buffer
 	size_t originalLength = strlen(expression);
-	char* newExpression = (char*)malloc(originalLength + 2 + 2 + 1);
-	if (!newExpression)
-	{
-		fprintf(stderr, "Cannot allocate the memory.\n");
-		exit(1);
-	}
+	char newExpression[EXPRESSION_BUFFER_SIZE + 2 + 2 + 1];
 
 	// add the parenthesis and exclude the special case, which is "(exp)"
 	while (TRUE)
@@ -281,7 +487,7 @@ char* addParenthesis(char* expression)
 		while (TRUE)
 		{
 			// judge whether insert a left parenthesis
-			if (isOperator(newExpression[currentIndex]) && isdigit(newExpression[currentIndex + 1]) && !(rand((unsigned int)time(NULL)) % 3))
+			if (isOperator(newExpression[currentIndex]) && isdigit(newExpression[currentIndex + 1]) && !(nextRandom(random) % 3))
 			{
 				insert(newExpression, '(', currentIndex);
 				leftIndex = currentIndex + 1;
@@ -296,7 +502,7 @@ char* addParenthesis(char* expression)
 		while (TRUE)
 		{
 			// judge whether insert a right parenthesis
-			if (isdigit(newExpression[currentIndex]) && isOperator(newExpression[currentIndex + 1]) && !(rand((unsigned int)time(NULL)) % 3))
+			if (isdigit(newExpression[currentIndex]) && isOperator(newExpression[currentIndex + 1]) && !(nextRandom(random) % 3))
 			{
 				insert(newExpression, ')', currentIndex);
 				currentIndex = (currentIndex - leftIndex + 1) % (strlen(newExpression) - leftIndex) + leftIndex;
@@ -311,9 +517,7 @@ char* addParenthesis(char* expression)
 		if (!isSpecialCase(newExpression + 1))
 		{
 			// copy the result to the dst
-			memcpy(expression, newExpression + 1, strlen(newExpression + 1));
-			// free the buffer
-			free(newExpression);
+			memcpy(expression, newExpression + 1, strlen(newExpression + 1) + 1);
 			// return to the caller
 			return expression;
 		}
@@ -324,37 +528,32 @@ char* addParenthesis(char* expression)
  * description: 
  * get an randomly generated expression 
  * 
- * argument:
- * size_t numberOfOperators: number of operators in the expression
+ * arguments:
+ * size_t numberOfOperators: number of operators in the expression,
+ * at most NUMBER_OF_OPERATOR
+ * Random* random: the generator to draw from
+ * char* expression: the dst buffer of EXPRESSION_BUFFER_SIZE characters
  * 
  * return:
  * char* expression: a string representing the expression
  ****************************************************************/ 
-char* getExpression(size_t numberOfOperators)
+char* getExpression(size_t numberOfOperators, Random* random, char* expression)
 {
-	// allocate the heap memory for the expression to be returned
-	char* expression = (char*)malloc(numberOfOperators + 3 * (numberOfOperators + 1) + 100);
-	if (!expression) 
-	{
-		fprintf(stderr, "Cannot allocate the memory.\n");
-		exit(1);
-	}
-	memset(expression, 0, numberOfOperators + 3 * (numberOfOperators + 1) + 100);
-	
 	// generate the expression
 	size_t expressionIndex = 0;
 	for (size_t i = 0; i < numberOfOperators; i++)
 	{
 		// generate a random number from [0, 100] and put the it into the `expression`
-		putNumber(getRandomNumber(0, 100), expression, &expressionIndex);
+		putNumber(getRandomNumber(random, 0, 100), expression, &expressionIndex);
 		// put a random operator to the `expression`
-		expression[expressionIndex++] = getRandomOperator();
+		expression[expressionIndex++] = getRandomOperator(random);
 	}
 	// put the last operand to the expression
-	putNumber(getRandomNumber(0, 100), expression, &expressionIndex);
+	putNumber(getRandomNumber(random, 0, 100), expression, &expressionIndex);
+	expression[expressionIndex] = '\0';
 	
 	// add a pair of parenthesis to the expression
-	return addParenthesis(expression);
+	return addParenthesis(expression, random);
 }
 
 /****************************************************************
@@ -369,7 +568,22 @@ void error(void)
 
 /****************************************************************
  * description:
- * match a token
+ * append a character to the right associative form of the
+ * expression in process
+ *
+ * arguments:
+ * RewrittenExpression* rewrittenExpression: the dst, or NULL
+ * when the right associative form is not wanted
+ * char character: the character to be appended
+ ****************************************************************/
+void emit(RewrittenExpression* rewrittenExpression, char character)
+{
+	if (rewrittenExpression) rewrittenExpression->text[rewrittenExpression->length++] = character;
+}
+
+/****************************************************************
+ * description:
+ * match a token and copy it to the right associative form
  *
  * arguments:
  * char expectedToken: the expected token to be matched
@@ -377,13 +591,38 @@ void error(void)
  * size_t* nextIndex: the index where you will get the next token
  * from `expression`
  * char* globalToken: the current token
+ * RewrittenExpression* rewrittenExpression: the right
+ * associative form, or NULL
  ****************************************************************/
-void match(char expectedToken, char* expression, size_t* nextIndex, char* globalToken)
+void match(char expectedToken, char* expression, size_t* nextIndex, char* globalToken, RewrittenExpression* rewrittenExpression)
 {
-	if (*globalToken == expectedToken) *globalToken = getNextChar(expression, nextIndex);
+	if (*globalToken == expectedToken)
+	{
+		emit(rewrittenExpression, expectedToken);
+		*globalToken = getNextChar(expression, nextIndex);
+	}
 	else error();
 }
 
+/****************************************************************
+ * description:
+ * divide, remembering a division by zero instead of crashing
+ *
+ * arguments:
+ * LL dividend: the dividend
+ * LL divisor: the divisor
+ * int* isDividedByZero: set to TRUE if `divisor` is 0
+ *
+ * return:
+ * `dividend` / `divisor`, or `dividend` if `divisor` is 0
+ ****************************************************************/
+LL divide(LL dividend, LL divisor, int* isDividedByZero)
+{
+	if (divisor) return dividend / divisor;
+	*isDividedByZero = TRUE;
+	return dividend;
+}
+
 /****************************************************************
  * description:
  * parse a factor
@@ -396,43 +635,32 @@ void match(char expectedToken, char* expression, size_t* nextIndex, char* global
  * int* isDividedByZero: the flag which indicates whether
  * the "divied by zero" exception happens when parsing
  * int associativity: LEFT or RIGHT
- * RewrittenExpressions* rewrittenExpressions:
- * if associativity == RIGHT, store rewritten expressions
+ * RewrittenExpression* rewrittenExpression: the right
+ * associative form, or NULL
  *
  * return:
  * the value of the factor
  ****************************************************************/
-LL factor(char* expression, size_t* nextIndex, char* globalToken, int* isDividedByZero, int associativity, RewrittenExpressions* rewrittenExpressions)
+LL factor(char* expression, size_t* nextIndex, char* globalToken, int* isDividedByZero, int associativity, RewrittenExpression* rewrittenExpression)
 {
-	LL temp;
+	LL temp = 0;
 	if (*globalToken == '(')
 	{
-		match('(', expression, nextIndex, globalToken);
-		// synchronize `nextIndex` with `rewrittenExpressions->currentRewrittenExpressionNextCharIndex`
-		if (associativity == RIGHT) (rewrittenExpressions->currentRewrittenExpressionNextCharIndex)++;
-		temp = exp(expression, nextIndex, globalToken, isDividedByZero, associativity, rewrittenExpressions);
-		match(')', expression, nextIndex, globalToken);
-		// synchronize `nextIndex` with `rewrittenExpressions->currentRewrittenExpressionNextCharIndex`
-		if (associativity == RIGHT) (rewrittenExpressions->currentRewrittenExpressionNextCharIndex)++;
+		match('(', expression, nextIndex, globalToken, rewrittenExpression);
+		temp = exp(expression, nextIndex, globalToken, isDividedByZero, associativity, rewrittenExpression);
+		match(')', expression, nextIndex, globalToken, rewrittenExpression);
 	}
-	else
-		if (isdigit(*globalToken))
-		{
-			ungetNextChar(nextIndex);
-			// synchronize `nextIndex` with `rewrittenExpressions->currentRewrittenExpressionNextCharIndex`
-			if (associativity == RIGHT) (rewrittenExpressions->currentRewrittenExpressionNextCharIndex)--;
-			temp = getInt(expression, nextIndex, globalToken, associativity, rewrittenExpressions);
-			*globalToken = getNextChar(expression, nextIndex, globalToken);
-			// synchronize `nextIndex` with `rewrittenExpressions->currentRewrittenExpressionNextCharIndex`
-			if (associativity == RIGHT) (rewrittenExpressions->currentRewrittenExpressionNextCharIndex)++;
-		}
-		else error();
+	else if (isdigit(*globalToken))
+		temp = getInt(expression, nextIndex, globalToken, rewrittenExpression);
+	else error();
 	return temp;
 }
 
 /****************************************************************
  * description:
- * parse a term
+ * parse a term. In the right associative order the rest of the
+ * term is the right operand, and it is put in parenthesis in the
+ * rewritten expression
  *
  * arguments:
  * char* expression: the current expression in process
@@ -442,99 +670,38 @@ LL factor(char* expression, size_t* nextIndex, char* globalToken, int* isDivided
  * int* isDividedByZero: the flag which indicates whether
  * the "divied by zero" exception happens when parsing
  * int associativity: LEFT or RIGHT
- * RewrittenExpressions* rewrittenExpressions:
- * if associativity == RIGHT, store rewritten expressions
+ * RewrittenExpression* rewrittenExpression: the right
+ * associative form, or NULL
  *
  * return:
  * the value of the term
  ****************************************************************/
-LL term(char* expression, size_t* nextIndex, char* globalToken, int* isDividedByZero, int associativity, RewrittenExpressions* rewrittenExpressions)
+LL term(char* expression, size_t* nextIndex, char* globalToken, int* isDividedByZero, int associativity, RewrittenExpression* rewrittenExpression)
 {
-	switch (associativity)
-	{
-	case LEFT:
-	{
-		LL temp = factor(expression, nextIndex, globalToken, isDividedByZero, associativity, rewrittenExpressions);
-		while (*globalToken == '*' || *globalToken == '/')
-		{
-			if (*globalToken == '*')
-			{
-				match('*', expression, nextIndex, globalToken);
-				temp *= factor(expression, nextIndex, globalToken, isDividedByZero, associativity, rewrittenExpressions);
-			}
-			if (*globalToken == '/')
-			{
-				match('/', expression, nextIndex, globalToken);
-				int divisor = factor(expression, nextIndex, globalToken, isDividedByZero, associativity, rewrittenExpressions);
-				if (divisor) temp /= divisor;
-				else
-				{
-					temp /= 1;
-					*isDividedByZero = TRUE;
-				}
-			}
-		}
-
-		return temp;
-	}
-	case RIGHT:
+	LL temp = factor(expression, nextIndex, globalToken, isDividedByZero, associativity, rewrittenExpression);
+	while (*globalToken == '*' || *globalToken == '/')
 	{
-		LL temp = factor(expression, nextIndex, globalToken, isDividedByZero, associativity, rewrittenExpressions);
-		while (*globalToken == '*' || *globalToken == '/')
+		char operator = *globalToken;
+		LL operand;
+		match(operator, expression, nextIndex, globalToken, rewrittenExpression);
+		if (associativity == LEFT) operand = factor(expression, nextIndex, globalToken, isDividedByZero, associativity, rewrittenExpression);
+		else
 		{
-			if (*globalToken == '*')
-			{
-				match('*', expression, nextIndex, globalToken);
-
-				// first, insert a '('
-				insert(rewrittenExpressions->rewrittenExpressions[rewrittenExpressions->currentRewrittenExpressionIndex], '(', rewrittenExpressions->currentRewrittenExpressionNextCharIndex - 1);
-				// skip the '('
-				(rewrittenExpressions->currentRewrittenExpressionNextCharIndex)++;
-				// then, synchronize `nextIndex` with `rewrittenExpressions->currentRewrittenExpressionNextCharIndex`
-				(rewrittenExpressions->currentRewrittenExpressionNextCharIndex)++;
-
-				temp *= term(expression, nextIndex, globalToken, isDividedByZero, associativity, rewrittenExpressions);
-
-				// first, insert a ')'
-				insert(rewrittenExpressions->rewrittenExpressions[rewrittenExpressions->currentRewrittenExpressionIndex], ')', rewrittenExpressions->currentRewrittenExpressionNextCharIndex - 2);
-				// skip the ')'
-				(rewrittenExpressions->currentRewrittenExpressionNextCharIndex)++;
-			}
-			if (*globalToken == '/')
-			{
-				match('/', expression, nextIndex, globalToken);
-
-				// first, insert a '('
-				insert(rewrittenExpressions->rewrittenExpressions[rewrittenExpressions->currentRewrittenExpressionIndex], '(', rewrittenExpressions->currentRewrittenExpressionNextCharIndex - 1);
-				// skip the '('
-				(rewrittenExpressions->currentRewrittenExpressionNextCharIndex)++;
-				// then, synchronize `nextIndex` with `rewrittenExpressions->currentRewrittenExpressionNextCharIndex`
-				(rewrittenExpressions->currentRewrittenExpressionNextCharIndex)++;
-
-				LL divisor = term(expression, nextIndex, globalToken, isDividedByZero, associativity, rewrittenExpressions);
-
-				// first, insert a ')'
-				insert(rewrittenExpressions->rewrittenExpressions[rewrittenExpressions->currentRewrittenExpressionIndex], ')', rewrittenExpressions->currentRewrittenExpressionNextCharIndex - 2);
-				// skip the ')'
-				(rewrittenExpressions->currentRewrittenExpressionNextCharIndex)++;
-
-				if (divisor) temp /= divisor;
-				else
-				{
-					temp /= 1;
-					*isDividedByZero = TRUE;
-				}
-			}
+			emit(rewrittenExpression, '(');
+			operand = term(expression, nextIndex, globalToken, isDividedByZero, associativity, rewrittenExpression);
+			emit(rewrittenExpression, ')');
 		}
-
-		return temp;
-	}
+		if (operator == '*') temp *= operand;
+		else temp = divide(temp, operand, isDividedByZero);
 	}
+	return temp;
 }
 
 /****************************************************************
  * description:
- * parse an expression
+ * parse an expression. In the right associative order the rest
+ * of the expression is the right operand, and it is put in
+ * parenthesis in the rewritten expression
  *
  * arguments:
  * char* expression: the current expression in process
@@ -544,152 +711,65 @@ LL term(char* expression, size_t* nextIndex, char* globalToken, int* isDividedBy
  * int* isDividedByZero: the flag which indicates whether 
  * the "divied by zero" exception happens when parsing
  * int associativity: LEFT or RIGHT
- * RewrittenExpressions* rewrittenExpressions:
- * if associativity == RIGHT, store rewritten expressions
+ * RewrittenExpression* rewrittenExpression: the right
+ * associative form, or NULL
  * 
  * return:
  * the value of the expression
  ****************************************************************/
-LL exp(char* expression, size_t* nextIndex, char* globalToken, int* isDividedByZero, int associativity, RewrittenExpressions* rewrittenExpressions)
+LL exp(char* expression, size_t* nextIndex, char* globalToken, int* isDividedByZero, int associativity, RewrittenExpression* rewrittenExpression)
 {
-	switch (associativity)
-	{
-	case LEFT: 
-	{
-		LL temp = term(expression, nextIndex, globalToken, isDividedByZero, associativity, rewrittenExpressions);
-		while ((*globalToken == '+') || (*globalToken == '-'))
-			switch (*globalToken)
-			{
-			case '+':
-				match('+', expression, nextIndex, globalToken);
-				temp += term(expression, nextIndex, globalToken, isDividedByZero, associativity, rewrittenExpressions);
-				break;
-			case '-':
-				match('-', expression, nextIndex, globalToken);
-				temp -= term(expression, nextIndex, globalToken, isDividedByZero, associativity, rewrittenExpressions);
-				break;
-			}
-		return temp;
-	}
-	case RIGHT:
+	LL temp = term(expression, nextIndex, globalToken, isDividedByZero, associativity, rewrittenExpression);
+	while (*globalToken == '+' || *globalToken == '-')
 	{
-		LL temp = term(expression, nextIndex, globalToken, isDividedByZero, associativity, rewrittenExpressions);
-		while ((*globalToken == '+') || (*globalToken == '-'))
-			switch (*globalToken)
-			{
-			case '+':
-				match('+', expression, nextIndex, globalToken);
-
-				// first, insert a '('
-				insert(rewrittenExpressions->rewrittenExpressions[rewrittenExpressions->currentRewrittenExpressionIndex], '(', rewrittenExpressions->currentRewrittenExpressionNextCharIndex - 1);
-				// skip the '('
-				(rewrittenExpressions->currentRewrittenExpressionNextCharIndex)++;
-				// then, synchronize `nextIndex` with `rewrittenExpressions->currentRewrittenExpressionNextCharIndex`
-				(rewrittenExpressions->currentRewrittenExpressionNextCharIndex)++;
-
-				temp += exp(expression, nextIndex, globalToken, isDividedByZero, associativity, rewrittenExpressions);
-
-				// first, insert a ')'
-				insert(rewrittenExpressions->rewrittenExpressions[rewrittenExpressions->currentRewrittenExpressionIndex], ')', rewrittenExpressions->currentRewrittenExpressionNextCharIndex - 2);
-				// skip the ')'
-				(rewrittenExpressions->currentRewrittenExpressionNextCharIndex)++;
-
-				break;
-			case '-':
-				match('-', expression, nextIndex, globalToken);
-
-				// first, insert a '('
-				insert(rewrittenExpressions->rewrittenExpressions[rewrittenExpressions->currentRewrittenExpressionIndex], '(', rewrittenExpressions->currentRewrittenExpressionNextCharIndex - 1);
-				// skip the '('
-				(rewrittenExpressions->currentRewrittenExpressionNextCharIndex)++;
-				// then, synchronize `nextIndex` with `rewrittenExpressions->currentRewrittenExpressionNextCharIndex`
-				(rewrittenExpressions->currentRewrittenExpressionNextCharIndex)++;
-
-				temp -= exp(expression, nextIndex, globalToken, isDividedByZero, associativity, rewrittenExpressions);
-
-				// first, insert a ')'
-				insert(rewrittenExpressions->rewrittenExpressions[rewrittenExpressions->currentRewrittenExpressionIndex], ')', rewrittenExpressions->currentRewrittenExpressionNextCharIndex - 2);
-				// skip the ')'
-				(rewrittenExpressions->currentRewrittenExpressionNextCharIndex)++;
-
-				break;
-			}
-		return temp;
-	}
+		char operator = *globalToken;
+		LL operand;
+		match(operator, expression, nextIndex, globalToken, rewrittenExpression);
+		if (associativity == LEFT) operand = term(expression, nextIndex, globalToken, isDividedByZero, associativity, rewrittenExpression);
+		else
+		{
+			emit(rewrittenExpression, '(');
+			operand = exp(expression, nextIndex, globalToken, isDividedByZero, associativity, rewrittenExpression);
+			emit(rewrittenExpression, ')');
+		}
+		if (operator == '+') temp += operand;
+		else temp -= operand;
 	}
+	return temp;
 }
 
 /****************************************************************
  * description:
- * get the 10's power
- *
- * arguments:
- * int power: the power
- *
- * return:
- * an int, whose value is 10^`power`
- ****************************************************************/
-LL powerOfTen(int power)
-{
-	LL result = 1;
-	for (int i = power; i > 0; i--) result *= 10;
-	return result;
-}
-
-/****************************************************************
- * description:
- * get an int from `expression`. This method will read all digits
- * from the `nextIndex` position until encounter the first non-
- * digital character
+ * get an int from `expression`. This method reads all digits
+ * from the current token on until it encounters the first non-
+ * digital character, building the value as it goes
  *
  * arguments:
  * char* expression: the current expression in process
  * size_t* nextIndex: the index where you will get the next token
  * from `expression`
- * char* globalToken: the current token
- * RewrittenExpressions* rewrittenExpressions:
- * if associativity == RIGHT, store rewritten expressions
+ * char* globalToken: the current token, the most significant
+ * digit of the int
+ * RewrittenExpression* rewrittenExpression: the right
+ * associative form, or NULL
  *
  * return:
- * an int whose the most significant digit locates at `nextInt`
- * position
+ * the value of the int
  ****************************************************************/
-LL getInt(char* expression, size_t* nextIndex, char* globalToken, int associativity, RewrittenExpressions* rewrittenExpressions)
+LL getInt(char* expression, size_t* nextIndex, char* globalToken, RewrittenExpression* rewrittenExpression)
 {
-	// temp buffer to store digits in reverse order
-	int* digits = (int*)malloc(sizeof(int) * 10000);
-	if (!digits)
-	{
-		fprintf(stderr, "Cannot allocate the memory.\n");
-		exit(1);
-	}
-	memset(digits, 0, sizeof(int) * 10000);
-	// index variable for the do-while loop
-	int i = -1;
-	// put digits into the temp buffer in reverse order
-	while (isdigit((int)(*globalToken = getNextChar(expression, nextIndex))) && i < 10000) digits[++i] = char2Digit(*globalToken);
-	// synchronize `nextIndex` with `rewrittenExpressions->currentRewrittenExpressionNextCharIndex`
-	if (associativity == RIGHT) rewrittenExpressions->currentRewrittenExpressionNextCharIndex += i + 2;
-	// check the condition which lead to the exit
-	if (i >= 10000)
-	{
-		fprintf(stderr, "Too big integer.\n");
-		exit(1);
-	}
-	// put the first non-digital character back to the expression string
-	ungetNextChar(nextIndex);
-	// synchronize `nextIndex` with `rewrittenExpressions->currentRewrittenExpressionNextCharIndex`
-	if (associativity == RIGHT) (rewrittenExpressions->currentRewrittenExpressionNextCharIndex)--;
-	// construct the int
 	LL tempSum = 0;
-	int highestPower = i;
-	while (i >= 0)
+	while (isdigit(*globalToken))
 	{
-		tempSum += digits[i] * powerOfTen(highestPower - i);
-		i--;
+		if (tempSum > (LLONG_MAX - 9) / 10)
+		{
+			fprintf(stderr, "Too big integer.\n");
+			exit(1);
+		}
+		tempSum = tempSum * 10 + char2Digit(*globalToken);
+		emit(rewrittenExpression, *globalToken);
+		*globalToken = getNextChar(expression, nextIndex);
 	}
-	
-	free(digits);
 	return tempSum;
 }
 
@@ -697,146 +777,1390 @@ LL getInt(char* expression, size_t* nextIndex, char* globalToken, int associativ
  * description:
  * get the result of an expression. If the "divided by zero"
  * exception happens, rewrite the expression until the exception
- * won't happen.
+ * won't happen. Nothing is allocated: the expression is rewritten
+ * in place and the right associative form goes to the caller's
+ * buffer
  *
  * arguments:
- * char* expression: the current expression to be processed
+ * char* expression: the current expression to be processed, in a
+ * buffer of EXPRESSION_BUFFER_SIZE characters
  * int associativity: LEFT or RIGHT
- * RewrittenExpressions* rewrittenExpressions: 
- * if associativity == RIGHT, store rewritten expressions
+ * char* rewrittenExpression: if associativity == RIGHT and it is
+ * not NULL, a buffer of REWRITTEN_BUFFER_SIZE characters which
+ * receives the right associative form of the expression
+ * Random* random: the generator used to rewrite the expression
  *
  * return:
  * the value of the expression
  ****************************************************************/
-LL getResult(char** expression, int associativity, RewrittenExpressions* rewrittenExpressions)
+LL getResult(char* expression, int associativity, char* rewrittenExpression, Random* random)
 {
-	// initialize the rewritten expression
-	if (associativity == RIGHT)
+	RewrittenExpression rewritten;
+	RewrittenExpression* target = associativity == RIGHT && rewrittenExpression ? &rewritten : NULL;
+	rewritten.text = rewrittenExpression;
+
+	while (TRUE)
 	{
-		// allocate new heap memory for the rewritten expression
-		if ((rewrittenExpressions->rewrittenExpressions)[++(rewrittenExpressions->currentRewrittenExpressionIndex)] = (char*)malloc(2 * strlen(*expression)))
+		int isDividedByZero = FALSE;
+		size_t nextIndex = 0;
+		char globalToken = getNextChar(expression, &nextIndex);
+		rewritten.length = 0;
+
+		// get the result;
+		LL result = exp(expression, &nextIndex, &globalToken, &isDividedByZero, associativity, target);
+		if (!isDividedByZero)
 		{
-			memset((rewrittenExpressions->rewrittenExpressions)[rewrittenExpressions->currentRewrittenExpressionIndex], 0, 2 * strlen(*expression));
-			memcpy((rewrittenExpressions->rewrittenExpressions)[rewrittenExpressions->currentRewrittenExpressionIndex], *expression, strlen(*expression));
+			if (target) rewritten.text[rewritten.length] = '\0';
+			return result;
 		}
+
+		// rewrite the expression
+		getExpression(NUMBER_OF_OPERATOR, random, expression);
+	}
+}
+
+void compileExp(Shape* shape, size_t* nextIndex, int associativity, char* program, int* length, RewrittenExpression* rewrittenShape, int* operand);
+
+/****************************************************************
+ * description:
+ * compile a factor of a shape
+ *
+ * arguments:
+ * Shape* shape: the shape in process
+ * size_t* nextIndex: the index of the next character of the shape
+ * int associativity: LEFT or RIGHT
+ * char* program: the dst program
+ * int* length: the number of instructions in `program`
+ * RewrittenExpression* rewrittenShape: the right associative
+ * form, or NULL
+ * int* operand: the number of operands met so far
+ ****************************************************************/
+void compileFactor(Shape* shape, size_t* nextIndex, int associativity, char* program, int* length, RewrittenExpression* rewrittenShape, int* operand)
+{
+	if (shape->shape[*nextIndex] == '(')
+	{
+		emit(rewrittenShape, shape->shape[(*nextIndex)++]);
+		compileExp(shape, nextIndex, associativity, program, length, rewrittenShape, operand);
+		emit(rewrittenShape, shape->shape[(*nextIndex)++]);
+	}
+	else
+	{
+		emit(rewrittenShape, shape->shape[(*nextIndex)++]);
+		program[(*length)++] = (char)(*operand)++;
+	}
+}
+
+/****************************************************************
+ * description:
+ * compile a term of a shape; the same walk as `term`, producing
+ * instructions instead of values
+ *
+ * arguments: see `compileFactor`
+ ****************************************************************/
+void compileTerm(Shape* shape, size_t* nextIndex, int associativity, char* program, int* length, RewrittenExpression* rewrittenShape, int* operand)
+{
+	compileFactor(shape, nextIndex, associativity, program, length, rewrittenShape, operand);
+	while (shape->shape[*nextIndex] == '*' || shape->shape[*nextIndex] == '/')
+	{
+		char operator = shape->shape[(*nextIndex)++];
+		emit(rewrittenShape, operator);
+		if (associativity == LEFT) compileFactor(shape, nextIndex, associativity, program, length, rewrittenShape, operand);
 		else
 		{
-			fprintf(stderr, "Cannot allocate the memory.\n");
-			exit(1);
+			emit(rewrittenShape, '(');
+			compileTerm(shape, nextIndex, associativity, program, length, rewrittenShape, operand);
+			emit(rewrittenShape, ')');
 		}
-		// rewind the position pointer
-		rewrittenExpressions->currentRewrittenExpressionNextCharIndex = 0;
+		program[(*length)++] = operator;
 	}
+}
 
-	int isDividedByZero = FALSE;
-	size_t nextIndex = 0;
-	char globalToken = getNextChar(*expression, &nextIndex);
-	// synchronize `nextIndex` with `rewrittenExpressions->currentRewrittenExpressionNextCharIndex`
-	if (associativity == RIGHT) (rewrittenExpressions->currentRewrittenExpressionNextCharIndex)++;
-
-	// get the result;
-	LL result = exp(*expression, &nextIndex, &globalToken, &isDividedByZero, associativity, rewrittenExpressions);
-	while (isDividedByZero)
+/****************************************************************
+ * description:
+ * compile an expression of a shape; the same walk as `exp`,
+ * producing instructions instead of values
+ *
+ * arguments: see `compileFactor`
+ ****************************************************************/
+void compileExp(Shape* shape, size_t* nextIndex, int associativity, char* program, int* length, RewrittenExpression* rewrittenShape, int* operand)
+{
+	compileTerm(shape, nextIndex, associativity, program, length, rewrittenShape, operand);
+	while (shape->shape[*nextIndex] == '+' || shape->shape[*nextIndex] == '-')
 	{
-		// rewrite the expression
-		if (*expression) free(*expression);
-		*expression = getExpression(NUMBER_OF_OPERATOR);
-		// reset the rewritten expression
-		if (associativity == RIGHT)
+		char operator = shape->shape[(*nextIndex)++];
+		emit(rewrittenShape, operator);
+		if (associativity == LEFT) compileTerm(shape, nextIndex, associativity, program, length, rewrittenShape, operand);
+		else
 		{
-			// release the heap memory allocated to the current rewritten expression
-			free((rewrittenExpressions->rewrittenExpressions)[rewrittenExpressions->currentRewrittenExpressionIndex]);
-			// allocate new heap memory for the rewritten expression
-			if ((rewrittenExpressions->rewrittenExpressions)[rewrittenExpressions->currentRewrittenExpressionIndex] = (char*)malloc(2 * strlen(*expression)))
-			{
-				memset((rewrittenExpressions->rewrittenExpressions)[rewrittenExpressions->currentRewrittenExpressionIndex], 0, 2 * strlen(*expression));
-				memcpy((rewrittenExpressions->rewrittenExpressions)[rewrittenExpressions->currentRewrittenExpressionIndex], *expression, strlen(*expression));
-			}
-			else
-			{
-				fprintf(stderr, "Cannot allocate the memory.\n");
-				exit(1);
-			}
-			// rewind the position pointer
-			rewrittenExpressions->currentRewrittenExpressionNextCharIndex = 0;
+			emit(rewrittenShape, '(');
+			compileExp(shape, nextIndex, associativity, program, length, rewrittenShape, operand);
+			emit(rewrittenShape, ')');
 		}
-		// reset the flag
-		isDividedByZero = FALSE;
-		// reset the "global variables"
-		nextIndex = 0;
-		globalToken = getNextChar(*expression, &nextIndex);
-		// synchronize `nextIndex` with `rewrittenExpressions->currentRewrittenExpressionNextCharIndex`
-		if (associativity == RIGHT) (rewrittenExpressions->currentRewrittenExpressionNextCharIndex)++;
-		// get the result;
-		result = exp(*expression, &nextIndex, &globalToken, &isDividedByZero, associativity, rewrittenExpressions);
+		program[(*length)++] = operator;
 	}
-	
-	return result;
 }
 
 /****************************************************************
  * description:
- * the driver code
+ * find the shape of an expression, compiling it the first time
+ * it is seen
+ *
+ * arguments:
+ * Batch* batch: the batch which keeps the shapes
+ * char* shape: the shape, '#' standing for the numbers
+ * unsigned hash: the hash of `shape`
  *
  * return:
- * the status code for OS
+ * the number of the shape, or -1 if there is no room for it
  ****************************************************************/
-int main()
+int findShape(Batch* batch, char* shape, unsigned hash)
 {
-	srand((unsigned int)time(NULL));
-
-	// initialize RewrittenExpressions
-	RewrittenExpressions rewrittenExpressions;
-	rewrittenExpressions.currentRewrittenExpressionNextCharIndex = 0;
-	rewrittenExpressions.currentRewrittenExpressionIndex = -1;
-	for (int i = 0; i < NUMBER_OF_QUESTION; i++) rewrittenExpressions.rewrittenExpressions[i] = NULL;
-
-	// generate NUMBER_OF_QUESTION expressions
-	char* expressions[NUMBER_OF_QUESTION] = { NULL };
-	for (int i = 0; i < NUMBER_OF_QUESTION; i++) expressions[i] = getExpression(NUMBER_OF_OPERATOR);
-
-	freopen("output.txt", "w", stdout);
-
-	// solve the questions in the left associative order one by one
-#if RELEASE_FLAG == ON
-	printf("Answers in the left associative order:\n");
-#endif
-
-	for (int i = 0; i < NUMBER_OF_QUESTION; i++)
+	size_t slot = hash & (SHAPE_TABLE_SIZE - 1);
+	for (; batch->shapeTable[slot]; slot = (slot + 1) & (SHAPE_TABLE_SIZE - 1))
 	{
-		LL result = getResult(&(expressions[i]), LEFT, &rewrittenExpressions);
-		printf("%s == %lld\n", expressions[i], result);
+		Shape* known = &batch->shapes[batch->shapeTable[slot] - 1];
+		if (known->hash == hash && !strcmp(known->shape, shape)) return batch->shapeTable[slot] - 1;
 	}
+	if (batch->numberOfShapes == MAX_SHAPES) return -1;
 
-#if RELEASE_FLAG == ON
-	printf("\n=============================================\n\n");
-	// solve the questions in the right associative order one by one
-	printf("Answers in the right associative order:\n");
-#endif
+	Shape* added = &batch->shapes[batch->numberOfShapes];
+	RewrittenExpression rewrittenShape = { added->rewrittenShape, 0 };
+	size_t nextIndex = 0;
+	int length = 0, operand = 0;
+	strcpy(added->shape, shape);
+	added->hash = hash;
+	added->count = 0;
+	compileExp(added, &nextIndex, LEFT, added->leftProgram, &length, NULL, &operand);
+	nextIndex = 0;
+	length = operand = 0;
+	compileExp(added, &nextIndex, RIGHT, added->rightProgram, &length, &rewrittenShape, &operand);
+	rewrittenShape.text[rewrittenShape.length] = '\0';
 
-	LL rightAssociativeAnswers[NUMBER_OF_QUESTION];
-	for (int i = 0; i < NUMBER_OF_QUESTION; i++)
-	{
-		rightAssociativeAnswers[i] = getResult(&(expressions[i]), RIGHT, &rewrittenExpressions);
-#if RELEASE_FLAG == ON
-		printf("%s == %lld\n", expressions[i], rightAssociativeAnswers[i]);
-#endif
-	}
+	batch->shapeTable[slot] = ++(batch->numberOfShapes);
+	return batch->numberOfShapes - 1;
+}
 
-#if RELEASE_FLAG == OFF
-	// print the rewritten expressions with their answers
-	for (int i = 0; i < NUMBER_OF_QUESTION; i++) printf("%s == %lld\n", rewrittenExpressions.rewrittenExpressions[i], rightAssociativeAnswers[i]);
+#ifdef __AVX2__
+/****************************************************************
+ * description:
+ * multiply 64-bit lanes keeping the low 64 bits, which AVX2 has
+ * no instruction for: lo*lo plus the cross products shifted up
+ *
+ * arguments:
+ * __m256i a, __m256i b: the factors
+ *
+ * return:
+ * the products
+ ****************************************************************/
+__m256i multiplyLanes(__m256i a, __m256i b)
+{
+	__m256i swapped = _mm256_shuffle_epi32(b, 0xB1);
+	__m256i crossProducts = _mm256_mullo_epi32(a, swapped);
+	__m256i crossSums = _mm256_hadd_epi32(crossProducts, _mm256_setzero_si256());
+	__m256i high = _mm256_shuffle_epi32(crossSums, 0x73);
+	return _mm256_add_epi64(_mm256_mul_epu32(a, b), high);
+}
 #endif
 
-	// free the memory
-	for (int i = 0; i < NUMBER_OF_QUESTION; i++)
+/****************************************************************
+ * description:
+ * apply an operator to two columns of numbers, LANES at a time.
+ * A division by zero divides by 1 instead, as `term` does, and is
+ * recorded for the row it happens in
+ *
+ * arguments:
+ * int instruction: the operator
+ * LL* left, LL* right: the operands; `result` may be either one
+ * LL* result: receives the values
+ * char* dividedByZero: set for the rows which divide by zero
+ * int count: the number of rows, rounded up to LANES
+ ****************************************************************/
+void runInstruction(int instruction, LL* left, LL* right, LL* result, char* dividedByZero, int count)
+{
+#ifdef __AVX2__
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i one = _mm256_set1_epi64x(1);
+	for (int k = 0; k < count; k += LANES)
 	{
-		if (expressions[i])
-			free(expressions[i]);
-		if (rewrittenExpressions.rewrittenExpressions[i])
-			free(rewrittenExpressions.rewrittenExpressions[i]);
-	}
-		
+		__m256i a = _mm256_loadu_si256((__m256i*)(left + k));
+		__m256i b = _mm256_loadu_si256((__m256i*)(right + k));
+		switch (instruction)
+		{
+		case '+':
+			a = _mm256_add_epi64(a, b);
+			break;
+		case '-':
+			a = _mm256_sub_epi64(a, b);
+			break;
+		case '*':
+			a = multiplyLanes(a, b);
+			break;
+		default:
+		{
+			// AVX2 cannot divide integers, so the lanes are divided one by one
+			__m256i isZero = _mm256_cmpeq_epi64(b, zero);
+			int zeroLanes = _mm256_movemask_pd(_mm256_castsi256_pd(isZero));
+			LL dividends[LANES], divisors[LANES];
+			_mm256_storeu_si256((__m256i*)dividends, a);
+			_mm256_storeu_si256((__m256i*)divisors, _mm256_blendv_epi8(b, one, isZero));
+			for (int lane = 0; lane < LANES; lane++)
+			{
+				dividends[lane] /= divisors[lane];
+				dividedByZero[k + lane] |= (char)((zeroLanes >> lane) & 1);
+			}
+			a = _mm256_loadu_si256((__m256i*)dividends);
+			break;
+		}
+		}
+		_mm256_storeu_si256((__m256i*)(result + k), a);
+	}
+#else
+	switch (instruction)
+	{
+	case '+':
+		for (int k = 0; k < count; k++) result[k] = left[k] + right[k];
+		break;
+	case '-':
+		for (int k = 0; k < count; k++) result[k] = left[k] - right[k];
+		break;
+	case '*':
+		for (int k = 0; k < count; k++) result[k] = left[k] * right[k];
+		break;
+	default:
+		for (int k = 0; k < count; k++)
+		{
+			int isDividedByZero = FALSE;
+			result[k] = divide(left[k], right[k], &isDividedByZero);
+			if (isDividedByZero) dividedByZero[k] = TRUE;
+		}
+		break;
+	}
+#endif
+}
+
+/****************************************************************
+ * description:
+ * run a postfix program on every expression of a shape, one
+ * instruction at a time over the whole group
+ *
+ * arguments:
+ * Batch* batch: the batch
+ * Shape* shape: the shape
+ * char* program: its left or right program
+ * LL* results: receives the value of each expression of the chunk
+ * char* dividedByZero: receives whether each expression of the
+ * chunk divides by zero
+ ****************************************************************/
+void runProgram(Batch* batch, Shape* shape, char* program, LL* results, char* dividedByZero)
+{
+	LL* stack[NUMBER_OF_OPERANDS];
+	int top = 0;
+	int count = (shape->count + LANES - 1) / LANES * LANES;
+	memset(batch->dividedByZero, FALSE, count);
+	for (int i = 0; i < PROGRAM_SIZE; i++)
+	{
+		int instruction = program[i];
+		if (instruction < NUMBER_OF_OPERANDS)
+		{
+			// operands are read in place; only results take a column
+			stack[top++] = batch->columns[instruction] + shape->start;
+			continue;
+		}
+		top--;
+		runInstruction(instruction, stack[top - 1], stack[top], batch->stack[top - 1], batch->dividedByZero, count);
+		stack[top - 1] = batch->stack[top - 1];
+	}
+	for (int k = 0; k < shape->count; k++)
+	{
+		results[batch->order[shape->start + k]] = stack[0][k];
+		dividedByZero[batch->order[shape->start + k]] = batch->dividedByZero[k];
+	}
+}
+
+/****************************************************************
+ * description:
+ * evaluate the expressions of a chunk in both orders. Each one is
+ * split into its numbers and its shape, the expressions are
+ * sorted by shape and every shape is run on its whole group
+ *
+ * arguments:
+ * Batch* batch: the batch; its shapes are kept between chunks
+ * char expressions[][EXPRESSION_BUFFER_SIZE]: the expressions
+ * size_t count: the number of expressions
+ ****************************************************************/
+void evaluateBatch(Batch* batch, char expressions[][EXPRESSION_BUFFER_SIZE], size_t count)
+{
+	for (int i = 0; i < batch->numberOfShapes; i++) batch->shapes[i].count = 0;
+
+	// split the expressions into numbers and shapes
+	for (size_t i = 0; i < count; i++)
+	{
+		char shape[EXPRESSION_BUFFER_SIZE];
+		unsigned hash = 2166136261u;
+		int operand = 0, length = 0, isValid = TRUE;
+		for (char* p = expressions[i]; *p; )
+		{
+			char character = *p;
+			if (character >= '0' && character <= '9')
+			{
+				LL number = 0;
+				while (*p >= '0' && *p <= '9') number = number * 10 + char2Digit(*p++);
+				if (operand == NUMBER_OF_OPERANDS) isValid = FALSE;
+				else batch->operands[i][operand++] = number;
+				character = '#';
+			}
+			else p++;
+			shape[length++] = character;
+			hash = (hash ^ (unsigned char)character) * 16777619u;
+		}
+		shape[length] = '\0';
+
+		int number = isValid && operand == NUMBER_OF_OPERANDS ? findShape(batch, shape, hash) : -1;
+		batch->shapeOf[i] = number;
+		if (number >= 0) batch->shapes[number].count++;
+	}
+
+	// sort the expressions by shape and lay their numbers out in columns
+	int start = 0;
+	for (int s = 0; s < batch->numberOfShapes; s++)
+	{
+		batch->shapes[s].start = start;
+		start += batch->shapes[s].count;
+		batch->shapes[s].count = 0;
+	}
+	for (size_t i = 0; i < count; i++)
+	{
+		if (batch->shapeOf[i] < 0) continue;
+		Shape* shape = &batch->shapes[batch->shapeOf[i]];
+		int position = shape->start + shape->count++;
+		batch->order[position] = (int)i;
+		for (int j = 0; j < NUMBER_OF_OPERANDS; j++) batch->columns[j][position] = batch->operands[i][j];
+	}
+	// the last group reads up to LANES - 1 rows past the end
+	for (int j = 0; j < NUMBER_OF_OPERANDS; j++)
+		for (int k = start; k < start + LANES; k++) batch->columns[j][k] = 1;
+
+	for (int s = 0; s < batch->numberOfShapes; s++)
+	{
+		Shape* shape = &batch->shapes[s];
+		if (!shape->count) continue;
+		runProgram(batch, shape, shape->leftProgram, batch->leftResults, batch->leftDividedByZero);
+		runProgram(batch, shape, shape->rightProgram, batch->rightResults, batch->rightDividedByZero);
+	}
+}
+
+/****************************************************************
+ * description:
+ * write the right associative form of an expression from its
+ * shape and numbers
+ *
+ * arguments:
+ * Batch* batch: the batch the expression was evaluated in
+ * size_t index: the number of the expression in the chunk
+ * char* rewrittenExpression: a buffer of REWRITTEN_BUFFER_SIZE
+ * characters
+ ****************************************************************/
+void rewriteFromShape(Batch* batch, size_t index, char* rewrittenExpression)
+{
+	size_t length = 0;
+	int operand = 0;
+	for (char* p = batch->shapes[batch->shapeOf[index]].rewrittenShape; *p; p++)
+		if (*p == '#') putNumber((int)batch->operands[index][operand++], rewrittenExpression, &length);
+		else rewrittenExpression[length++] = *p;
+	rewrittenExpression[length] = '\0';
+}
+
+/****************************************************************
+ * description:
+ * write out the characters held by a `Writer`. A writer without
+ * a file only collects text and must never fill up
+ *
+ * arguments:
+ * Writer* writer: the writer to be flushed
+ ****************************************************************/
+void flushWriter(Writer* writer)
+{
+	if (!writer->file)
+	{
+		fprintf(stderr, "The buffer of a chunk is full.\n");
+		exit(1);
+	}
+	if (writer->length && fwrite(writer->buffer, 1, writer->length, writer->file) != writer->length)
+	{
+		fprintf(stderr, "Cannot write the output.\n");
+		exit(1);
+	}
+	writer->length = 0;
+}
+
+/****************************************************************
+ * description:
+ * append a string to a `Writer`
+ *
+ * arguments:
+ * Writer* writer: the dst writer
+ * char* string: the string to be appended
+ ****************************************************************/
+void writeString(Writer* writer, char* string)
+{
+	size_t length = strlen(string);
+	if (writer->length + length > WRITER_BUFFER_SIZE) flushWriter(writer);
+	memcpy(writer->buffer + writer->length, string, length);
+	writer->length += length;
+}
+
+/****************************************************************
+ * description:
+ * append the decimal form of a number to a `Writer`. The digits
+ * are produced two at a time from a table instead of going
+ * through `printf`
+ *
+ * arguments:
+ * Writer* writer: the dst writer
+ * LL number: the number to be appended
+ ****************************************************************/
+void writeNumber(Writer* writer, LL number)
+{
+	static const char digitPairs[] =
+		"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+		"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+		"8081828384858687888990919293949596979899";
+	// an LL has at most 19 digits and a sign
+	char buffer[20];
+	int length = 20;
+	// work on the magnitude so that LLONG_MIN does not overflow
+	unsigned long long magnitude = number < 0 ? 0ULL - (unsigned long long)number : (unsigned long long)number;
+
+	while (magnitude >= 100)
+	{
+		int pair = (int)(magnitude % 100) * 2;
+		magnitude /= 100;
+		buffer[--length] = digitPairs[pair + 1];
+		buffer[--length] = digitPairs[pair];
+	}
+	if (magnitude >= 10)
+	{
+		buffer[--length] = digitPairs[magnitude * 2 + 1];
+		buffer[--length] = digitPairs[magnitude * 2];
+	}
+	else buffer[--length] = digit2Char((int)magnitude);
+	if (number < 0) buffer[--length] = '-';
+
+	if (writer->length + sizeof(buffer) > WRITER_BUFFER_SIZE) flushWriter(writer);
+	memcpy(writer->buffer + writer->length, buffer + length, sizeof(buffer) - length);
+	writer->length += sizeof(buffer) - length;
+}
+
+/****************************************************************
+ * description:
+ * append a line "`expression` == `result`" to a `Writer`
+ *
+ * arguments:
+ * Writer* writer: the dst writer
+ * char* expression: the expression
+ * LL result: the value of the expression
+ ****************************************************************/
+void writeAnswer(Writer* writer, char* expression, LL result)
+{
+	writeString(writer, expression);
+	writeString(writer, " == ");
+	writeNumber(writer, result);
+	writeString(writer, "\n");
+}
+
+/****************************************************************
+ * description:
+ * generate, solve and format the questions of one chunk. Runs on
+ * a worker thread; the chunk only draws from its own generator,
+ * which is seeded from the chunk index, so the text produced does
+ * not depend on the number of threads
+ *
+ * arguments:
+ * void* argument: the `Job` describing the chunk
+ *
+ * return:
+ * 0
+ ****************************************************************/
+int solveChunk(void* argument)
+{
+	Job* job = (Job*)argument;
+	char rewrittenExpression[REWRITTEN_BUFFER_SIZE];
+
+	seedRandom(&job->random, job->seed, job->chunk);
+
+	// generate the questions of this chunk
+	for (size_t i = 0; i < job->count; i++) getExpression(NUMBER_OF_OPERATOR, &job->random, job->expressions[i]);
+
+#if BATCH_FLAG == ON
+	// Evaluating draws no random numbers, so as long as the expressions
+	// which divide by zero are rewritten by `getResult` in the same order
+	// as before, the output does not change. A rewritten expression is
+	// solved by `getResult` in the right associative order too
+	Batch* batch = &job->batch;
+	evaluateBatch(batch, job->expressions, job->count);
+#endif
+
+	// solve the questions in the left associative order one by one
+	for (size_t i = 0; i < job->count; i++)
+	{
+		LL result;
+#if BATCH_FLAG == ON
+		if (batch->shapeOf[i] >= 0 && !batch->leftDividedByZero[i]) result = batch->leftResults[i];
+		else
+		{
+			result = getResult(job->expressions[i], LEFT, NULL, &job->random);
+			batch->shapeOf[i] = -1;
+		}
+#else
+		result = getResult(job->expressions[i], LEFT, NULL, &job->random);
+#endif
+		writeAnswer(&job->leftAnswers, job->expressions[i], result);
+	}
+
+	// solve the questions in the right associative order one by one
+	for (size_t i = 0; i < job->count; i++)
+	{
+		LL result;
+#if BATCH_FLAG == ON
+		if (batch->shapeOf[i] >= 0 && !batch->rightDividedByZero[i])
+		{
+			result = batch->rightResults[i];
+			rewriteFromShape(batch, i, rewrittenExpression);
+		}
+		else result = getResult(job->expressions[i], RIGHT, rewrittenExpression, &job->random);
+#else
+		result = getResult(job->expressions[i], RIGHT, rewrittenExpression, &job->random);
+#endif
+#if RELEASE_FLAG == ON
+		writeAnswer(&job->rightAnswers, job->expressions[i], result);
+#else
+		// print the rewritten expressions with their answers
+		writeAnswer(&job->rightAnswers, rewrittenExpression, result);
+#endif
+	}
 
 	return 0;
-}
\ No newline at end of file
+}
+
+/****************************************************************
+ * description:
+ * the body of a worker thread: solve the queued chunks in index
+ * order until the main thread says there are no more. The workers
+ * stay alive for the whole run, so they go on with the next chunks
+ * while the main thread writes the finished ones
+ *
+ * arguments:
+ * void* argument: the `Queue` to take the chunks from
+ *
+ * return:
+ * 0
+ ****************************************************************/
+int work(void* argument)
+{
+	Queue* queue = (Queue*)argument;
+
+	mtx_lock(&queue->lock);
+	for (;;)
+	{
+		while (queue->taken == queue->queued && !queue->finished) cnd_wait(&queue->work, &queue->lock);
+		if (queue->taken == queue->queued) break;
+		Job* job = &queue->jobs[queue->taken++ % queue->numberOfJobs];
+		mtx_unlock(&queue->lock);
+
+		solveChunk(job);
+
+		mtx_lock(&queue->lock);
+		job->solved = TRUE;
+		cnd_signal(&queue->solved);
+	}
+	mtx_unlock(&queue->lock);
+
+	return 0;
+}
+
+/****************************************************************
+ * description:
+ * get the current time in seconds
+ *
+ * return:
+ * the current time in seconds
+ ****************************************************************/
+double seconds(void)
+{
+	struct timespec now;
+	timespec_get(&now, TIME_UTC);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/****************************************************************
+ * description:
+ * map a whole file into memory for reading
+ *
+ * arguments:
+ * char* path: the file to be mapped
+ * size_t* size: receives the size of the file
+ *
+ * return:
+ * the contents of the file, or NULL if it cannot be mapped
+ ****************************************************************/
+const char* mapFile(char* path, size_t* size)
+{
+	static const char empty[1] = { '\0' };
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	LARGE_INTEGER fileSize;
+	if (file == INVALID_HANDLE_VALUE) return NULL;
+	if (!GetFileSizeEx(file, &fileSize))
+	{
+		CloseHandle(file);
+		return NULL;
+	}
+	*size = (size_t)fileSize.QuadPart;
+	if (*size == 0)
+	{
+		CloseHandle(file);
+		return empty;
+	}
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	const char* contents = mapping ? (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+	// the view keeps the file open
+	if (mapping) CloseHandle(mapping);
+	CloseHandle(file);
+	return contents;
+#else
+	struct stat status;
+	int file = open(path, O_RDONLY);
+	if (file < 0) return NULL;
+	if (fstat(file, &status) < 0)
+	{
+		close(file);
+		return NULL;
+	}
+	*size = (size_t)status.st_size;
+	if (*size == 0)
+	{
+		close(file);
+		return empty;
+	}
+	void* contents = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, file, 0);
+	// the mapping keeps the file open
+	close(file);
+	if (contents == MAP_FAILED) return NULL;
+	madvise(contents, *size, MADV_SEQUENTIAL);
+	return (const char*)contents;
+#endif
+}
+
+/****************************************************************
+ * description:
+ * release a file mapped by `mapFile`
+ *
+ * arguments:
+ * const char* contents: the contents returned by `mapFile`
+ * size_t size: the size of the file
+ ****************************************************************/
+void unmapFile(const char* contents, size_t size)
+{
+	if (size == 0) return;
+#ifdef _WIN32
+	UnmapViewOfFile(contents);
+#else
+	munmap((void*)contents, size);
+#endif
+}
+
+/****************************************************************
+ * description:
+ * add, subtract, multiply or divide two numbers, detecting
+ * overflow and division by zero
+ *
+ * arguments:
+ * char operator: one of '+', '-', '*', '/'
+ * LL left: the left operand
+ * LL right: the right operand
+ * LL* result: receives the result
+ *
+ * return:
+ * CHECK_OK, CHECK_OVERFLOW or CHECK_DIVIDED_BY_ZERO
+ ****************************************************************/
+int checkedOperation(char operator, LL left, LL right, LL* result)
+{
+	switch (operator)
+	{
+	case '+':
+		if ((right > 0 && left > LLONG_MAX - right) || (right < 0 && left < LLONG_MIN - right)) return CHECK_OVERFLOW;
+		*result = left + right;
+		return CHECK_OK;
+	case '-':
+		if ((right < 0 && left > LLONG_MAX + right) || (right > 0 && left < LLONG_MIN + right)) return CHECK_OVERFLOW;
+		*result = left - right;
+		return CHECK_OK;
+	case '*':
+	{
+		// compare the magnitudes, the negative range is one larger
+		unsigned long long leftMagnitude = left < 0 ? 0ULL - (unsigned long long)left : (unsigned long long)left;
+		unsigned long long rightMagnitude = right < 0 ? 0ULL - (unsigned long long)right : (unsigned long long)right;
+		unsigned long long limit = (left < 0) != (right < 0) ? (unsigned long long)LLONG_MAX + 1 : (unsigned long long)LLONG_MAX;
+		if (rightMagnitude && leftMagnitude > limit / rightMagnitude) return CHECK_OVERFLOW;
+		*result = (LL)(leftMagnitude * rightMagnitude * ((left < 0) != (right < 0) ? -1ULL : 1ULL));
+		return CHECK_OK;
+	}
+	default:
+		if (!right) return CHECK_DIVIDED_BY_ZERO;
+		if (left == LLONG_MIN && right == -1) return CHECK_OVERFLOW;
+		*result = left / right;
+		return CHECK_OK;
+	}
+}
+
+/****************************************************************
+ * description:
+ * read a decimal number, detecting overflow
+ *
+ * arguments:
+ * const char** next: the first digit; moved past the last one
+ * const char* end: the end of the text
+ * int isNegative: whether the number is preceded by '-'
+ * LL* result: receives the number
+ *
+ * return:
+ * CHECK_OK or CHECK_OVERFLOW
+ ****************************************************************/
+int checkedNumber(const char** next, const char* end, int isNegative, LL* result)
+{
+	unsigned long long limit = isNegative ? (unsigned long long)LLONG_MAX + 1 : (unsigned long long)LLONG_MAX;
+	unsigned long long magnitude = 0;
+	const char* p = *next;
+	for (; p < end && isdigit((unsigned char)*p); p++)
+	{
+		unsigned digit = (unsigned)(*p - '0');
+		if (magnitude > (limit - digit) / 10) return CHECK_OVERFLOW;
+		magnitude = magnitude * 10 + digit;
+	}
+	*next = p;
+	*result = isNegative ? (LL)(0ULL - magnitude) : (LL)magnitude;
+	return CHECK_OK;
+}
+
+/****************************************************************
+ * description:
+ * get the precedence of an operator on the verifier's stack
+ *
+ * argument:
+ * char operator: '+', '-', '*', '/' or '('
+ *
+ * return:
+ * the precedence; '(' has the lowest
+ ****************************************************************/
+int precedence(char operator)
+{
+	switch (operator)
+	{
+	case '+':
+	case '-':
+		return 1;
+	case '*':
+	case '/':
+		return 2;
+	default:
+		return 0;
+	}
+}
+
+/****************************************************************
+ * description:
+ * pop an operator and two values and push the result
+ *
+ * arguments:
+ * LL* values: the value stack
+ * int* valueCount: the number of values on the stack
+ * char operator: the operator to apply
+ *
+ * return:
+ * CHECK_OK, CHECK_OVERFLOW, CHECK_DIVIDED_BY_ZERO or
+ * CHECK_MALFORMED
+ ****************************************************************/
+int reduce(LL* values, int* valueCount, char operator)
+{
+	if (*valueCount < 2) return CHECK_MALFORMED;
+	int status = checkedOperation(operator, values[*valueCount - 2], values[*valueCount - 1], &values[*valueCount - 2]);
+	(*valueCount)--;
+	return status;
+}
+
+/****************************************************************
+ * description:
+ * evaluate an infix expression with the usual precedence, using a
+ * shunting-yard over an operator and a value stack. Independent
+ * of `exp`, `term` and `factor`, so that it can check them
+ *
+ * arguments:
+ * const char* p: the expression
+ * const char* end: the end of the expression
+ * int associativity: LEFT or RIGHT
+ * LL* result: receives the value
+ *
+ * return:
+ * CHECK_OK, CHECK_OVERFLOW, CHECK_DIVIDED_BY_ZERO or
+ * CHECK_MALFORMED
+ ****************************************************************/
+int evaluateInfix(const char* p, const char* end, int associativity, LL* result)
+{
+	LL values[VERIFIER_STACK_SIZE];
+	char operators[VERIFIER_STACK_SIZE];
+	int valueCount = 0, operatorCount = 0;
+	int expectOperand = TRUE;
+	int status = CHECK_OK;
+
+	while (p < end && status == CHECK_OK)
+	{
+		char character = *p;
+		if (valueCount == VERIFIER_STACK_SIZE || operatorCount == VERIFIER_STACK_SIZE) return CHECK_MALFORMED;
+		if (character == ' ' || character == '\t' || character == '\r') p++;
+		else if (isdigit((unsigned char)character))
+		{
+			if (!expectOperand) return CHECK_MALFORMED;
+			status = checkedNumber(&p, end, FALSE, &values[valueCount++]);
+			expectOperand = FALSE;
+		}
+		else if (character == '(')
+		{
+			if (!expectOperand) return CHECK_MALFORMED;
+			operators[operatorCount++] = character;
+			p++;
+		}
+		else if (character == ')')
+		{
+			if (expectOperand) return CHECK_MALFORMED;
+			while (status == CHECK_OK && operatorCount && operators[operatorCount - 1] != '(')
+				status = reduce(values, &valueCount, operators[--operatorCount]);
+			if (!operatorCount) return CHECK_MALFORMED;
+			operatorCount--;
+			p++;
+		}
+		else if (character == '+' || character == '-' || character == '*' || character == '/')
+		{
+			if (expectOperand) return CHECK_MALFORMED;
+			// an operator of the same precedence on the stack is applied
+			// first in the left associative order, after this one in the
+			// right associative order
+			while (status == CHECK_OK && operatorCount &&
+				(associativity == LEFT ? precedence(operators[operatorCount - 1]) >= precedence(character)
+					: precedence(operators[operatorCount - 1]) > precedence(character)))
+				status = reduce(values, &valueCount, operators[--operatorCount]);
+			operators[operatorCount++] = character;
+			expectOperand = TRUE;
+			p++;
+		}
+		else return CHECK_MALFORMED;
+	}
+	if (status != CHECK_OK) return status;
+	if (expectOperand) return CHECK_MALFORMED;
+	while (status == CHECK_OK && operatorCount)
+	{
+		if (operators[operatorCount - 1] == '(') return CHECK_MALFORMED;
+		status = reduce(values, &valueCount, operators[--operatorCount]);
+	}
+	if (status == CHECK_OK && valueCount != 1) return CHECK_MALFORMED;
+	*result = values[0];
+	return status;
+}
+
+/****************************************************************
+ * description:
+ * check a line "expression == value"
+ *
+ * arguments:
+ * const char* line: the line
+ * const char* end: the end of the line
+ * const char* equal: the "==" in the line
+ * int associativity: LEFT or RIGHT
+ * LL* value: receives the value of the expression
+ *
+ * return:
+ * one of the CHECK_ results
+ ****************************************************************/
+int checkLine(const char* line, const char* end, const char* equal, int associativity, LL* value)
+{
+	const char* p = equal + 2;
+	LL expected;
+	int isNegative = FALSE;
+
+	// read the value on the right
+	while (p < end && (*p == ' ' || *p == '\t')) p++;
+	if (p < end && *p == '-')
+	{
+		isNegative = TRUE;
+		p++;
+	}
+	if (p == end || !isdigit((unsigned char)*p)) return CHECK_MALFORMED;
+	if (checkedNumber(&p, end, isNegative, &expected) != CHECK_OK) return CHECK_MALFORMED;
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+	if (p != end) return CHECK_MALFORMED;
+
+	// evaluate the expression on the left
+	int status = evaluateInfix(line, equal, associativity, value);
+	if (status != CHECK_OK) return status;
+	return *value == expected ? CHECK_OK : CHECK_WRONG;
+}
+
+/****************************************************************
+ * description:
+ * check the lines of a part of `output.txt`. Runs on a verifier
+ * thread; line numbers are counted from the start of the part
+ * and fixed up by the caller. Lines without "==" after some
+ * text, such as the headings and the separator written when
+ * RELEASE_FLAG is ON, are skipped, and the lines from
+ * `part->right` on are evaluated in the right associative order
+ *
+ * arguments:
+ * void* argument: the `Part` to be checked
+ *
+ * return:
+ * 0
+ ****************************************************************/
+int verifyPart(void* argument)
+{
+	Part* part = (Part*)argument;
+	const char* line = part->begin;
+	while (line < part->end)
+	{
+		const char* end = (const char*)memchr(line, '\n', part->end - line);
+		if (!end) end = part->end;
+		part->lines++;
+
+		const char* equal = (const char*)memchr(line, '=', end - line);
+		if (equal && equal > line && equal + 1 < end && equal[1] == '=')
+		{
+			LL value = 0;
+			int status = checkLine(line, end, equal, line >= part->right ? RIGHT : LEFT, &value);
+			part->checked++;
+			if (status != CHECK_OK)
+			{
+				if (part->failed < MAX_REPORTED_FAILURES)
+				{
+					Failure* failure = &part->failures[part->failed];
+					failure->line = part->lines;
+					failure->text = line;
+					failure->length = end - line;
+					failure->status = status;
+					failure->value = value;
+				}
+				part->failed++;
+			}
+		}
+		line = end + 1;
+	}
+	return 0;
+}
+
+/****************************************************************
+ * description:
+ * find the line of a file which starts with a text. The answers
+ * hold no letters, so looking for the first character of a heading
+ * skips them quickly
+ *
+ * arguments:
+ * const char* contents: the file
+ * size_t size: the size of the file
+ * const char* text: the start of the line
+ *
+ * return:
+ * the line after it, or the end of the file if there is no such
+ * line
+ ****************************************************************/
+const char* findLine(const char* contents, size_t size, const char* text)
+{
+	const char* end = contents + size;
+	size_t length = strlen(text);
+	const char* line = contents;
+	while ((line = (const char*)memchr(line, text[0], end - line)) != NULL)
+	{
+		if ((line == contents || line[-1] == '\n') && (size_t)(end - line) >= length && !memcmp(line, text, length))
+		{
+			const char* newline = (const char*)memchr(line, '\n', end - line);
+			return newline ? newline + 1 : end;
+		}
+		line++;
+	}
+	return end;
+}
+
+/****************************************************************
+ * description:
+ * check every "expression == value" line of a file with an
+ * evaluator independent of the one which wrote it, in the right
+ * associative order after the heading of the right associative
+ * answers written when RELEASE_FLAG is ON. The file is
+ * mapped into memory and cut at line boundaries into one part
+ * per thread
+ *
+ * arguments:
+ * char* path: the file to be checked
+ * int numberOfThreads: the number of verifier threads
+ *
+ * return:
+ * 0 if every line is right, 1 otherwise
+ ****************************************************************/
+int verify(char* path, int numberOfThreads)
+{
+	static const char* statusNames[] = { "right", "wrong value", "overflow", "divided by zero", "malformed" };
+	double start = seconds();
+	size_t size;
+	const char* contents = mapFile(path, &size);
+	if (!contents)
+	{
+		fprintf(stderr, "Cannot map %s.\n", path);
+		return 1;
+	}
+
+	// with RELEASE_FLAG ON the right associative answers follow their
+	// heading, written with the original expressions
+	const char* right = findLine(contents, size, RIGHT_HEADING);
+
+	Part* parts = (Part*)calloc(numberOfThreads, sizeof(Part));
+	thrd_t* threads = (thrd_t*)malloc(numberOfThreads * sizeof(thrd_t));
+	if (!parts || !threads)
+	{
+		fprintf(stderr, "Cannot allocate the memory.\n");
+		exit(1);
+	}
+
+	// cut the file just after a '\n'
+	const char* begin = contents;
+	for (int t = 0; t < numberOfThreads; t++)
+	{
+		const char* end = contents + size;
+		if (t < numberOfThreads - 1)
+		{
+			const char* newline = contents + size / numberOfThreads * (t + 1);
+			if (newline < begin) newline = begin;
+			newline = (const char*)memchr(newline, '\n', contents + size - newline);
+			if (newline) end = newline + 1;
+		}
+		parts[t].begin = begin;
+		parts[t].end = end;
+		parts[t].right = right;
+		begin = end;
+		if (thrd_create(&threads[t], verifyPart, &parts[t]) != thrd_success)
+		{
+			fprintf(stderr, "Cannot create a thread.\n");
+			exit(1);
+		}
+	}
+
+	// report the failures in line order
+	size_t lines = 0, checked = 0, failed = 0;
+	for (int t = 0; t < numberOfThreads; t++)
+	{
+		thrd_join(threads[t], NULL);
+		for (size_t i = 0; i < parts[t].failed && i < MAX_REPORTED_FAILURES && failed + i < MAX_REPORTED_FAILURES; i++)
+		{
+			Failure* failure = &parts[t].failures[i];
+			printf("line %zu: %.*s: %s", lines + failure->line, (int)(failure->length > 80 ? 80 : failure->length),
+				failure->text, statusNames[failure->status]);
+			if (failure->status == CHECK_WRONG) printf(", the value is %lld", failure->value);
+			printf("\n");
+		}
+		lines += parts[t].lines;
+		checked += parts[t].checked;
+		failed += parts[t].failed;
+	}
+	double elapsed = seconds() - start;
+
+	printf("%zu lines, %zu checked, %zu failed\n", lines, checked, failed);
+	printf("%.2f s, %.1f MB/s, %.2f M lines/s with %d threads\n", elapsed, size / elapsed / 1e6, lines / elapsed / 1e6, numberOfThreads);
+
+	unmapFile(contents, size);
+	free(threads);
+	free(parts);
+	return failed ? 1 : 0;
+}
+
+#if BENCHMARK_FLAG == ON
+// number of passes over the benchmark expressions
+#define BENCHMARK_ROUNDS 200
+
+/****************************************************************
+ * description:
+ * check `getResult` against answers recorded from the original
+ * evaluator, then measure how many expressions per second it
+ * solves in each order. When BATCH_FLAG is ON, also check the
+ * batch engine against `exp` and compare their speed
+ *
+ * return:
+ * the number of failed checks
+ ****************************************************************/
+int benchmark(void)
+{
+	static const struct
+	{
+		char* expression;
+		LL leftResult;
+		char* rewrittenExpression;
+		LL rightResult;
+	} regressionSet[] =
+	{
+		{ "1+2*3-4", 3, "1+(2*(3)-(4))", 3 },
+		{ "100/7/2", 7, "100/(7/(2))", 33 },
+		{ "8-4-2-1", 1, "8-(4-(2-(1)))", 5 },
+		{ "2*3*4/5", 4, "2*(3*(4/(5)))", 0 },
+		{ "(1+2)*3", 9, "(1+(2))*(3)", 9 },
+		{ "7-(3-2)", 6, "7-((3-(2)))", 6 },
+		{ "(8/4)/2", 1, "(8/(4))/(2)", 1 },
+		{ "0*5+3", 3, "0*(5)+(3)", 3 },
+		{ "10-(2+3)*4", -10, "10-((2+(3))*(4))", -10 },
+		{ "20/(3-1)/2", 5, "20/((3-(1))/(2))", 20 },
+		{ "99-98+97-96", 2, "99-(98+(97-(96)))", 0 },
+		{ "64/4*8/2", 64, "64/(4*(8/(2)))", 4 },
+		{ "5*(6-7)*8", -40, "5*((6-(7))*(8))", -40 },
+		{ "(12+34)/(5+6)", 4, "(12+(34))/((5+(6)))", 4 },
+		{ "3-(4*5-6)/7", 1, "3-((4*(5)-(6))/(7))", 1 },
+		{ "100*100*100-1", 999999, "100*(100*(100))-(1)", 999999 }
+	};
+	static char expressions[CHUNK_SIZE][EXPRESSION_BUFFER_SIZE];
+	char expression[EXPRESSION_BUFFER_SIZE];
+	char rewrittenExpression[REWRITTEN_BUFFER_SIZE];
+	int failures = 0;
+	Random random;
+	seedRandom(&random, 1, 0);
+
+	// check the regression set
+	for (size_t i = 0; i < sizeof(regressionSet) / sizeof(regressionSet[0]); i++)
+	{
+		strcpy(expression, regressionSet[i].expression);
+		LL leftResult = getResult(expression, LEFT, NULL, &random);
+		LL rightResult = getResult(expression, RIGHT, rewrittenExpression, &random);
+		if (leftResult != regressionSet[i].leftResult || rightResult != regressionSet[i].rightResult
+			|| strcmp(rewrittenExpression, regressionSet[i].rewrittenExpression))
+		{
+			printf("FAILED: %s == %lld, %s == %lld\n", regressionSet[i].expression, leftResult, rewrittenExpression, rightResult);
+			failures++;
+		}
+	}
+	printf("%d of %d regression checks failed\n", failures, (int)(sizeof(regressionSet) / sizeof(regressionSet[0])));
+
+	// measure the throughput; the first pass also replaces the
+	// expressions which divide by zero
+	for (size_t i = 0; i < CHUNK_SIZE; i++) getExpression(NUMBER_OF_OPERATOR, &random, expressions[i]);
+	for (size_t i = 0; i < CHUNK_SIZE; i++) getResult(expressions[i], RIGHT, rewrittenExpression, &random);
+	for (int associativity = LEFT; associativity <= RIGHT; associativity++)
+	{
+		volatile LL sink = 0;
+		double start = seconds();
+		for (int round = 0; round < BENCHMARK_ROUNDS; round++)
+			for (size_t i = 0; i < CHUNK_SIZE; i++)
+				sink += getResult(expressions[i], associativity, rewrittenExpression, &random);
+		double elapsed = seconds() - start;
+		printf("%s associative: %.2f M expressions/s\n", associativity == LEFT ? "left" : "right",
+			(double)BENCHMARK_ROUNDS * CHUNK_SIZE / elapsed / 1e6);
+	}
+
+#if BATCH_FLAG == ON
+	// check the batch engine against `exp` on fresh expressions, some
+	// of which divide by zero
+	static Batch batch;
+	int mismatches = 0, dividedByZero = 0;
+	for (size_t i = 0; i < CHUNK_SIZE; i++) getExpression(NUMBER_OF_OPERATOR, &random, expressions[i]);
+	evaluateBatch(&batch, expressions, CHUNK_SIZE);
+	for (size_t i = 0; i < CHUNK_SIZE; i++)
+	{
+		char rewrittenFromShape[REWRITTEN_BUFFER_SIZE];
+		int isLeftDividedByZero = FALSE, isRightDividedByZero = FALSE;
+		RewrittenExpression rewritten = { rewrittenExpression, 0 };
+		size_t nextIndex = 0;
+		char globalToken = getNextChar(expressions[i], &nextIndex);
+		LL leftResult = exp(expressions[i], &nextIndex, &globalToken, &isLeftDividedByZero, LEFT, NULL);
+		nextIndex = 0;
+		globalToken = getNextChar(expressions[i], &nextIndex);
+		LL rightResult = exp(expressions[i], &nextIndex, &globalToken, &isRightDividedByZero, RIGHT, &rewritten);
+		rewrittenExpression[rewritten.length] = '\0';
+
+		if (batch.shapeOf[i] < 0)
+		{
+			printf("MISMATCH: %s has no shape\n", expressions[i]);
+			mismatches++;
+			continue;
+		}
+		rewriteFromShape(&batch, i, rewrittenFromShape);
+		dividedByZero += isLeftDividedByZero || isRightDividedByZero;
+		if (isLeftDividedByZero != batch.leftDividedByZero[i] || isRightDividedByZero != batch.rightDividedByZero[i]
+			|| (!isLeftDividedByZero && leftResult != batch.leftResults[i])
+			|| (!isRightDividedByZero && rightResult != batch.rightResults[i])
+			|| strcmp(rewrittenExpression, rewrittenFromShape))
+		{
+			printf("MISMATCH: %s == %lld, %s == %lld\n", expressions[i], batch.leftResults[i], rewrittenFromShape, batch.rightResults[i]);
+			mismatches++;
+		}
+	}
+	printf("batch: %d mismatches in %d expressions (%d dividing by zero, %d shapes)\n",
+		mismatches, CHUNK_SIZE, dividedByZero, batch.numberOfShapes);
+	failures += mismatches;
+
+	// compare the throughput with `getResult` solving both orders
+	for (int engine = 0; engine < 2; engine++)
+	{
+		volatile LL sink = 0;
+		double start = seconds();
+		for (int round = 0; round < BENCHMARK_ROUNDS; round++)
+		{
+			if (engine) evaluateBatch(&batch, expressions, CHUNK_SIZE);
+			for (size_t i = 0; i < CHUNK_SIZE; i++)
+				if (engine)
+				{
+					rewriteFromShape(&batch, i, rewrittenExpression);
+					sink += batch.leftResults[i] + batch.rightResults[i];
+				}
+				else
+				{
+					size_t nextIndex = 0;
+					int isDividedByZero = FALSE;
+					RewrittenExpression rewritten = { rewrittenExpression, 0 };
+					char globalToken = getNextChar(expressions[i], &nextIndex);
+					sink += exp(expressions[i], &nextIndex, &globalToken, &isDividedByZero, LEFT, NULL);
+					nextIndex = 0;
+					globalToken = getNextChar(expressions[i], &nextIndex);
+					sink += exp(expressions[i], &nextIndex, &globalToken, &isDividedByZero, RIGHT, &rewritten);
+				}
+		}
+		double elapsed = seconds() - start;
+#ifdef __AVX2__
+		printf("%s, both orders: %.2f M expressions/s\n", engine ? "batch (AVX2)" : "exp",
+#else
+		printf("%s, both orders: %.2f M expressions/s\n", engine ? "batch (scalar)" : "exp",
+#endif
+			(double)BENCHMARK_ROUNDS * CHUNK_SIZE / elapsed / 1e6);
+	}
+#endif
+
+	return failures;
+}
+#endif
+
+/****************************************************************
+ * description:
+ * the driver code. The questions are solved `CHUNK_SIZE` at a
+ * time by worker threads which stay `JOBS_PER_THREAD` chunks each
+ * ahead of the main thread, and the chunks are written in index
+ * order, so the same seed always gives the same
+ * `output.txt`. The right associative answers come after all the
+ * left associative ones, so they are kept in a temporary file
+ * until the end
+ *
+ * arguments:
+ * argv[1]: the seed (default: the current time)
+ * argv[2]: the number of threads (default: NUMBER_OF_THREADS)
+ * or, to check an output file instead:
+ * argv[1]: "-verify"
+ * argv[2]: the file to be checked (default: output.txt)
+ * argv[3]: the number of threads (default: NUMBER_OF_THREADS)
+ *
+ * return:
+ * the status code for OS
+ ****************************************************************/
+int main(int argc, char* argv[])
+{
+#if BENCHMARK_FLAG == ON
+	return benchmark();
+#endif
+
+	if (argc > 1 && !strcmp(argv[1], "-verify"))
+	{
+		int numberOfThreads = argc > 3 ? atoi(argv[3]) : NUMBER_OF_THREADS;
+		return verify(argc > 2 ? argv[2] : "output.txt", numberOfThreads < 1 ? 1 : numberOfThreads);
+	}
+
+	unsigned long long seed = argc > 1 ? strtoull(argv[1], NULL, 10) : (unsigned long long)time(NULL);
+	int numberOfThreads = argc > 2 ? atoi(argv[2]) : NUMBER_OF_THREADS;
+	if (numberOfThreads < 1) numberOfThreads = 1;
+	fprintf(stderr, "seed %llu, %d threads\n", seed, numberOfThreads);
+
+	FILE* output = fopen("output.txt", "w");
+	FILE* rightAnswers = tmpfile();
+	Queue queue;
+	queue.numberOfJobs = (size_t)JOBS_PER_THREAD * numberOfThreads;
+	// a job's batch keeps the shapes it has seen from chunk to
+	// chunk, so it must start out empty
+	queue.jobs = (Job*)calloc(queue.numberOfJobs, sizeof(Job));
+	queue.queued = queue.taken = 0;
+	queue.finished = FALSE;
+	thrd_t* threads = (thrd_t*)malloc(numberOfThreads * sizeof(thrd_t));
+	if (!output || !rightAnswers || !queue.jobs || !threads)
+	{
+		fprintf(stderr, "Cannot open the output files.\n");
+		exit(1);
+	}
+	if (mtx_init(&queue.lock, mtx_plain) != thrd_success || cnd_init(&queue.work) != thrd_success ||
+		cnd_init(&queue.solved) != thrd_success)
+	{
+		fprintf(stderr, "Cannot create the job queue.\n");
+		exit(1);
+	}
+	for (int t = 0; t < numberOfThreads; t++)
+		if (thrd_create(&threads[t], work, &queue) != thrd_success)
+		{
+			fprintf(stderr, "Cannot create a thread.\n");
+			exit(1);
+		}
+
+#if RELEASE_FLAG == ON
+	fprintf(output, "Answers in the left associative order:\n");
+#endif
+
+	size_t numberOfChunks = (NUMBER_OF_QUESTION + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	for (size_t chunk = 0; chunk < numberOfChunks; chunk++)
+	{
+		mtx_lock(&queue.lock);
+
+		// refill the jobs written so far with the next chunks
+		for (; queue.queued < numberOfChunks && queue.queued < chunk + queue.numberOfJobs; queue.queued++)
+		{
+			Job* job = &queue.jobs[queue.queued % queue.numberOfJobs];
+			size_t first = queue.queued * CHUNK_SIZE;
+			job->seed = seed;
+			job->chunk = queue.queued;
+			job->count = NUMBER_OF_QUESTION - first < CHUNK_SIZE ? NUMBER_OF_QUESTION - first : CHUNK_SIZE;
+			job->leftAnswers.file = job->rightAnswers.file = NULL;
+			job->leftAnswers.length = job->rightAnswers.length = 0;
+			job->solved = FALSE;
+			cnd_signal(&queue.work);
+		}
+
+		// write the chunks out in index order
+		Job* job = &queue.jobs[chunk % queue.numberOfJobs];
+		while (!job->solved) cnd_wait(&queue.solved, &queue.lock);
+		mtx_unlock(&queue.lock);
+
+		job->leftAnswers.file = output;
+		flushWriter(&job->leftAnswers);
+		job->rightAnswers.file = rightAnswers;
+		flushWriter(&job->rightAnswers);
+	}
+
+	mtx_lock(&queue.lock);
+	queue.finished = TRUE;
+	cnd_broadcast(&queue.work);
+	mtx_unlock(&queue.lock);
+	for (int t = 0; t < numberOfThreads; t++) thrd_join(threads[t], NULL);
+
+#if RELEASE_FLAG == ON
+	fprintf(output, "\n=============================================\n\n");
+	fprintf(output, RIGHT_HEADING "\n");
+#endif
+
+	// append the right associative answers
+	Writer* copy = &queue.jobs[0].leftAnswers;
+	copy->file = output;
+	rewind(rightAnswers);
+	while ((copy->length = fread(copy->buffer, 1, WRITER_BUFFER_SIZE, rightAnswers)) > 0) flushWriter(copy);
+
+	fclose(rightAnswers);
+	fclose(output);
+	cnd_destroy(&queue.solved);
+	cnd_destroy(&queue.work);
+	mtx_destroy(&queue.lock);
+	free(threads);
+	free(queue.jobs);
+
+	return 0;
+}